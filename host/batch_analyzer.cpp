@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <esp_log.h>
+#include "class_lut.hpp"
+#include "dataset.hpp"
+#include "png.hpp"
+#include "vision.hpp"
+
+/*
+ * Runs the firmware's detectors over a whole dataset on every core, in place
+ * of openimages.py, and writes one CSV row per frame plus optional overlays.
+ */
+
+namespace {
+    const char* TAG = "BATCH_ANALYZER";
+
+    struct Options {
+        const char* dataset = nullptr;
+        const char* csv = nullptr;
+        const char* overlays = nullptr;
+        int threads = 0;
+        int scale = 4;
+    };
+
+    struct Result {
+        Vision::BoxResult stop;
+        Vision::BoxResult car;
+        Vision::SteeringResult line;
+    };
+
+    // What each worker keeps between frames; the segmentation is too big for a thread's stack
+    struct Worker {
+        Vision::Segmentation segmentation;
+        Vision::WhiteLineDetector detector;
+        std::vector<uint8_t> overlay;
+    };
+
+    void usage(const char* program)
+    {
+        fprintf(stderr,
+                "Usage: %s DATASET [--csv FILE] [--overlays DIR] [--scale N] [--threads N]\n"
+                "\n"
+                "DATASET is a directory of IMAGE*.BIN captures or a container file.\n"
+                "  --csv FILE      Write the results to FILE instead of stdout\n"
+                "  --overlays DIR  Also draw the detections on each frame as DIR/<frame>.png\n"
+                "  --scale N       Magnification of the overlay images (default 4)\n"
+                "  --threads N     Worker threads (default: one per core)\n",
+                program);
+    }
+
+    bool parse(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; i++) {
+            const bool has_value = i + 1 < argc;
+            if (strcmp(argv[i], "--csv") == 0 && has_value) {
+                options.csv = argv[++i];
+            } else if (strcmp(argv[i], "--overlays") == 0 && has_value) {
+                options.overlays = argv[++i];
+            } else if (strcmp(argv[i], "--scale") == 0 && has_value) {
+                options.scale = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "--threads") == 0 && has_value) {
+                options.threads = atoi(argv[++i]);
+            } else if (argv[i][0] != '-' && !options.dataset) {
+                options.dataset = argv[i];
+            } else {
+                return false;
+            }
+        }
+        return options.dataset && options.scale > 0 && options.threads >= 0;
+    }
+
+    void fill(std::vector<uint8_t>& rgb, int width, int x, int y, const uint8_t colour[3])
+    {
+        uint8_t* px = &rgb[3 * (y * width + x)];
+        px[0] = colour[0];
+        px[1] = colour[1];
+        px[2] = colour[2];
+    }
+
+    // Outline a rectangle given in frame pixels, as cv::rectangle does in openimages.py
+    void draw_rect(std::vector<uint8_t>& rgb, int width, int scale, const Vision::Rect& box, const uint8_t colour[3])
+    {
+        const int x0 = box.x0 * scale;
+        const int y0 = box.y0 * scale;
+        const int x1 = box.x1 * scale - 1;
+        const int y1 = box.y1 * scale - 1;
+        for (int x = x0; x <= x1; x++) {
+            fill(rgb, width, x, y0, colour);
+            fill(rgb, width, x, y1, colour);
+        }
+        for (int y = y0; y <= y1; y++) {
+            fill(rgb, width, x0, y, colour);
+            fill(rgb, width, x1, y, colour);
+        }
+    }
+
+    void draw_point(std::vector<uint8_t>& rgb, int width, int scale, const Vision::Point& p, const uint8_t colour[3])
+    {
+        draw_rect(rgb, width, scale, {p.x, p.y, p.x + 1, p.y + 1}, colour);
+    }
+
+    esp_err_t write_overlay(const Dataset::Frame& frame, const Result& result, const Options& options,
+                            std::vector<uint8_t>& rgb)
+    {
+        static const uint8_t RED[3] = {255, 0, 0};
+        static const uint8_t GREEN[3] = {0, 255, 0};
+        static const uint8_t BLUE[3] = {0, 128, 255};
+        static const uint8_t YELLOW[3] = {255, 255, 0};
+        static const uint8_t GREY[3] = {128, 128, 128};
+
+        const int scale = options.scale;
+        const int width = frame.width * scale;
+        const int height = frame.height * scale;
+        rgb.assign(static_cast<size_t>(3) * width * height, 0);
+
+        const Vision::Frame view = frame.view();
+        for (int y = view.y0; y < frame.height; y++) {
+            for (int x = 0; x < frame.width; x++) {
+                const uint16_t code = view.at(x, y);
+                const uint8_t colour[3] = {RGB565::red8(code), RGB565::green8(code), RGB565::blue8(code)};
+                for (int sy = 0; sy < scale; sy++) {
+                    for (int sx = 0; sx < scale; sx++) {
+                        fill(rgb, width, x * scale + sx, y * scale + sy, colour);
+                    }
+                }
+            }
+        }
+
+        for (int x = 0; x < width; x++) {
+            fill(rgb, width, x, (Vision::WHITE_CROP_ROW + 1) * scale - 1, GREY);
+        }
+        draw_rect(rgb, width, scale, Vision::STOPBOX, result.stop.triggered ? RED : GREY);
+        draw_rect(rgb, width, scale, Vision::CARBOX, result.car.triggered ? GREEN : GREY);
+        if (result.line.found) {
+            draw_rect(rgb, width, scale, result.line.bounds, BLUE);
+            draw_point(rgb, width, scale, result.line.centroid, YELLOW);
+            draw_point(rgb, width, scale, result.line.top_left, RED);
+        }
+
+        // Keep only the file name of a capture; container frames are named path#index
+        std::string name = frame.name;
+        const size_t slash = name.find_last_of('/');
+        if (slash != std::string::npos) {
+            name = name.substr(slash + 1);
+        }
+        std::replace(name.begin(), name.end(), '#', '_');
+        const std::string path = std::string(options.overlays) + "/" + name + ".png";
+        return Png::write_rgb(path.c_str(), rgb.data(), width, height);
+    }
+
+    void print_row(FILE* out, const Dataset::Frame& frame, const Result& r)
+    {
+        const double angle = r.line.line.angle_q16 * (180.0 / M_PI) / 65536.0;
+        fprintf(out, "%s,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%.2f\n", frame.name.c_str(), r.stop.percent,
+                r.stop.triggered, r.car.percent, r.car.triggered, r.line.found, r.line.area, r.line.centroid.x,
+                r.line.centroid.y, r.line.top_left.x, r.line.top_left.y, r.line.steering, angle);
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parse(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    std::vector<Dataset::Frame> frames;
+    if (Dataset::load(options.dataset, frames) != ESP_OK) {
+        return 1;
+    }
+    if (options.overlays && mkdir(options.overlays, 0777) != 0 && errno != EEXIST) {
+        ESP_LOGE(TAG, "Cannot create %s", options.overlays);
+        return 1;
+    }
+    ClassLut::init(ClassLut::Placement::Flash);
+    const uint8_t* lut = ClassLut::table();
+
+    const int thread_count = options.threads ? options.threads
+                                             : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<Result> results(frames.size());
+    std::atomic<size_t> next{0};
+    std::atomic<uint32_t> overlay_errors{0};
+
+    // Each worker takes the next unclaimed frame until none are left
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; t++) {
+        threads.emplace_back([&]() {
+            std::unique_ptr<Worker> worker(new Worker);
+            for (size_t i = next++; i < frames.size(); i = next++) {
+                Vision::segment(frames[i].view(), worker->segmentation, lut);
+                Result& result = results[i];
+                result.stop = worker->segmentation.stop_box();
+                result.car = worker->segmentation.car_box();
+                result.line = worker->detector.detect(worker->segmentation);
+                if (options.overlays && write_overlay(frames[i], result, options, worker->overlay) != ESP_OK) {
+                    overlay_errors++;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    FILE* out = options.csv ? fopen(options.csv, "w") : stdout;
+    if (!out) {
+        ESP_LOGE(TAG, "Cannot write %s", options.csv);
+        return 1;
+    }
+    fprintf(out, "frame,stop_percent,stop,car_percent,car,line_found,line_area,centroid_x,centroid_y,"
+                 "top_left_x,top_left_y,steering,line_angle_deg\n");
+    for (size_t i = 0; i < frames.size(); i++) {
+        print_row(out, frames[i], results[i]);
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    if (overlay_errors) {
+        ESP_LOGE(TAG, "Failed to write %u overlays", (unsigned)overlay_errors.load());
+    }
+    fprintf(stderr, "Analyzed %u frames on %d threads in %.3f s (%.0f frames/s)\n", (unsigned)frames.size(),
+            thread_count, seconds, frames.size() / seconds);
+    return overlay_errors ? 1 : 0;
+}
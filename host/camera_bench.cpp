@@ -0,0 +1,139 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <esp_camera.h>
+#include <esp_log.h>
+#include "camera.hpp"
+#include "host_camera.hpp"
+
+/*
+ * Times handing frames between the replayed camera and the firmware, and
+ * counts the copies made out of the driver's buffers (the build wraps memcpy
+ * for this). Prints one JSON line per way of taking a frame: in place with a
+ * FrameHandle, copied out of it as get_frame(cv::Mat&) used to do, and, when
+ * OpenCV is found, through get_frame(cv::Mat&) itself.
+ */
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr size_t FRAME_BYTES = HostCamera::FRAME_SIZE * HostCamera::FRAME_SIZE * 2;
+
+    struct Options {
+        const char* frames = nullptr;
+        int count = 10000;
+    };
+
+    void usage(const char* program)
+    {
+        fprintf(stderr,
+                "Usage: %s [--frames DIR] [--count N]\n"
+                "\n"
+                "  --frames DIR  Replay the IMAGE*.BIN captures in DIR (default: generated frames)\n"
+                "  --count N     Frames to take with each method (default 10000)\n",
+                program);
+    }
+
+    double elapsed_ns(Clock::time_point from, Clock::time_point to)
+    {
+        return std::chrono::duration<double, std::nano>(to - from).count();
+    }
+
+    // A few frames of noise, when no captures are given
+    std::string write_frames()
+    {
+        std::string path = "/tmp/camera_bench_XXXXXX";
+        if (!mkdtemp(path.data())) {
+            perror("mkdtemp");
+            exit(1);
+        }
+        std::vector<uint8_t> pixels(FRAME_BYTES);
+        for (int i = 0; i < 8; i++) {
+            for (size_t j = 0; j < pixels.size(); j++) {
+                pixels[j] = static_cast<uint8_t>(j * 7 + i);
+            }
+            const std::string name = path + "/IMAGE" + std::to_string(i) + ".BIN";
+            FILE* out = fopen(name.c_str(), "wb");
+            fwrite(pixels.data(), 1, pixels.size(), out);
+            fclose(out);
+        }
+        return path;
+    }
+
+    // Take count frames with get, return each with put, and report the mean of both
+    template <typename Get, typename Put>
+    void bench(const char* method, int count, Get get, Put put)
+    {
+        double get_ns = 0;
+        double return_ns = 0;
+        HostCamera::reset_copy_stats();
+        for (int i = 0; i < count; i++) {
+            const Clock::time_point start = Clock::now();
+            get();
+            const Clock::time_point got = Clock::now();
+            put();
+            const Clock::time_point end = Clock::now();
+            get_ns += elapsed_ns(start, got);
+            return_ns += elapsed_ns(got, end);
+        }
+        const HostCamera::CopyStats copies = HostCamera::copy_stats();
+        printf("{\"method\": \"%s\", \"frames\": %d, \"get_ns\": %.0f, \"return_ns\": %.0f, "
+               "\"copies_per_frame\": %.2f, \"copied_bytes_per_frame\": %.0f}\n",
+               method, count, get_ns / count, return_ns / count, static_cast<double>(copies.copies) / count,
+               static_cast<double>(copies.bytes) / count);
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--frames") == 0 && has_value) {
+            options.frames = argv[++i];
+        } else if (strcmp(argv[i], "--count") == 0 && has_value) {
+            options.count = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.count <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    const std::string dir = options.frames ? options.frames : write_frames();
+    HostCamera::Config replay;
+    replay.directory = dir.c_str();
+    replay.loop = true;
+    if (HostCamera::configure(replay) != ESP_OK) {
+        return 1;
+    }
+    Camera::config_cam();
+
+    Camera::FrameHandle frame;
+    bench("handle", options.count, [&frame] { Camera::get_frame(frame); }, [&frame] { frame.reset(); });
+
+    std::vector<uint8_t> copy(FRAME_BYTES);
+    bench("handle_copy", options.count,
+          [&frame, &copy] {
+              Camera::get_frame(frame);
+              memcpy(copy.data(), frame.data(), frame.size());
+          },
+          [&frame] { frame.reset(); });
+
+#ifndef CAMERA_NO_OPENCV
+    // The buffer goes back inside get_frame(), so the return costs nothing here
+    cv::Mat image;
+    bench("mat", options.count, [&image] { Camera::get_frame(image); }, [] {});
+#endif
+
+    esp_camera_deinit();
+    return 0;
+}
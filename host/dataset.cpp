@@ -0,0 +1,113 @@
+#include "dataset.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <dirent.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <utility>
+#include <esp_log.h>
+#include "constants.hpp"
+#include "container.hpp"
+#include "esp_camera.h"
+
+namespace {
+    constexpr int FRAME_SIZE = 96;
+    constexpr size_t FRAME_BYTES = FRAME_SIZE * FRAME_SIZE * 2;
+
+    // Image number of a capture's file name, or -1 if it is not IMAGE{n}.BIN
+    int image_number(const char* name)
+    {
+        const size_t prefix_len = sizeof(FILE_PREFIX) - 1;
+        int number;
+        char extension[8];
+        if (strncasecmp(name, FILE_PREFIX, prefix_len) != 0 ||
+            sscanf(name + prefix_len, "%d%7s", &number, extension) != 2 ||
+            strcasecmp(extension, FILE_EXTENSION) != 0) {
+            return -1;
+        }
+        return number;
+    }
+
+    esp_err_t load_directory(const char* path, std::vector<Dataset::Frame>& frames)
+    {
+        DIR* dir = opendir(path);
+        if (!dir) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        std::vector<std::pair<int, std::string>> files;
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            const int number = image_number(entry->d_name);
+            if (number >= 0) {
+                files.emplace_back(number, entry->d_name);
+            }
+        }
+        closedir(dir);
+        std::sort(files.begin(), files.end());
+
+        for (const auto& file : files) {
+            const std::string full_path = std::string(path) + "/" + file.second;
+            FILE* in = fopen(full_path.c_str(), "rb");
+            if (!in) {
+                continue;
+            }
+            Dataset::Frame frame = {file.second, std::vector<uint8_t>(FRAME_BYTES + 1), FRAME_SIZE, FRAME_SIZE, 0};
+            const size_t length = fread(frame.pixels.data(), 1, frame.pixels.size(), in);
+            fclose(in);
+            if (length != FRAME_BYTES) {
+                ESP_LOGW(Dataset::TAG, "Skipping %s: not a 96x96 RGB565 frame", full_path.c_str());
+                continue;
+            }
+            frame.pixels.resize(FRAME_BYTES);
+            frames.push_back(std::move(frame));
+        }
+        return ESP_OK;
+    }
+
+    esp_err_t load_container(const char* path, std::vector<Dataset::Frame>& frames)
+    {
+        Container::Reader reader;
+        esp_err_t err = reader.open(path);
+        if (err != ESP_OK) {
+            return err;
+        }
+
+        Container::FrameHeader header;
+        std::vector<uint8_t> data;
+        for (size_t i = 0; reader.next(header, data) == ESP_OK; i++) {
+            const size_t expected = 2u * header.width * header.height;
+            if (header.format != PIXFORMAT_RGB565 || header.width > FRAME_SIZE ||
+                header.first_row + header.height > FRAME_SIZE || data.size() != expected) {
+                ESP_LOGW(Dataset::TAG, "Skipping frame %u of %s: not a 96x96 RGB565 frame", (unsigned)i, path);
+                continue;
+            }
+            frames.push_back({std::string(path) + "#" + std::to_string(i), data, header.width,
+                              header.first_row + header.height, header.first_row});
+        }
+        return ESP_OK;
+    }
+}
+
+
+esp_err_t Dataset::load(const char* path, std::vector<Frame>& frames)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        ESP_LOGE(TAG, "Dataset %s not found", path);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    frames.clear();
+    const esp_err_t err = S_ISDIR(st.st_mode) ? load_directory(path, frames) : load_container(path, frames);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read dataset %s", path);
+        return err;
+    }
+    if (frames.empty()) {
+        ESP_LOGE(TAG, "No frames in %s", path);
+        return ESP_ERR_NOT_FOUND;
+    }
+    ESP_LOGI(TAG, "Loaded %u frames from %s", (unsigned)frames.size(), path);
+    return ESP_OK;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <esp_err.h>
+#include "vision.hpp"
+
+/**
+ * @brief Loads recorded frames for the host tools
+ *
+ * A dataset is either a directory of IMAGE{n}.BIN captures, as saved by the
+ * firmware and read by openimages.py, or a container file written with
+ * Container::Writer. Every frame is read into memory up front.
+ */
+namespace Dataset {
+
+    /// @brief Tag used in ESP debug logs
+    static const char* TAG = "DATASET";
+
+    /// @brief One recorded RGB565 frame
+    struct Frame {
+        std::string name;               ///< File name, or container path and index
+        std::vector<uint8_t> pixels;    ///< Rows first_row to height - 1, two bytes per pixel
+        int width;
+        int height;                     ///< Height of the full frame
+        int first_row;                  ///< First row held in pixels
+
+        /// @brief The frame as the detectors take it
+        Vision::Frame view() const { return Vision::Frame{pixels.data(), width, height, first_row}; }
+    };
+
+    /**
+     * @brief Load every frame of a dataset
+     *
+     * Captures that are not a 96x96 RGB565 frame are skipped with a warning.
+     *
+     * @param path - A directory of captures or a container file
+     * @param frames - Receives the frames, in image number or container order
+     * @return esp_err_t - ESP_OK if at least one frame was loaded
+     */
+    esp_err_t load(const char* path, std::vector<Frame>& frames);
+}
@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+# Turn a binary log written by DeferredLog (include/deferred_log.hpp) back into
+# ESP_LOG style text. The log only holds the addresses of the format strings
+# and tags, so the ELF of the exact build that wrote it is needed:
+#
+#   python3 host/decode_log.py build/main.elf LOG.BIN
+#   python3 host/decode_log.py build-host/espcam_sim sdcard/LOG.BIN
+
+import argparse
+import re
+import struct
+import sys
+
+MAGIC = b"DLOG"
+VERSION = 1
+ANCHOR_SYMBOL = b"deferred_log_anchor"
+
+LEVELS = {1: "E", 2: "W", 3: "I", 4: "D", 5: "V"}
+
+SHT_SYMTAB = 2
+SHT_NOBITS = 8
+
+# printf conversions, with the length modifiers Python's % operator does not know
+CONVERSION = re.compile(r"%([-+ #0]*)(\*|\d+)?(\.(?:\*|\d+))?(hh|h|ll|l|j|z|t|L)?([diouxXeEfgGcsp])")
+
+
+class Elf:
+    """Reads the sections and symbols of a 32 or 64 bit little-endian ELF file."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[5] != 1:
+            raise ValueError(f"{path} is not a little-endian ELF file")
+        wide = self.data[4] == 2
+        if wide:
+            shoff, = struct.unpack_from("<Q", self.data, 0x28)
+            shentsize, shnum = struct.unpack_from("<HH", self.data, 0x3A)
+            section_layout = "<IIQQQQIIQQ"
+        else:
+            shoff, = struct.unpack_from("<I", self.data, 0x20)
+            shentsize, shnum = struct.unpack_from("<HH", self.data, 0x2E)
+            section_layout = "<IIIIIIIIII"
+
+        # (type, address, file offset, size, link, entry size) of each section
+        self.sections = []
+        for i in range(shnum):
+            _, kind, _, addr, offset, size, link, _, _, entsize = struct.unpack_from(
+                section_layout, self.data, shoff + i * shentsize)
+            self.sections.append((kind, addr, offset, size, link, entsize))
+        self.wide = wide
+
+    def symbol(self, name):
+        """Address of a symbol from the symbol table, or None."""
+        for kind, _, offset, size, link, entsize in self.sections:
+            if kind != SHT_SYMTAB:
+                continue
+            strtab = self.sections[link][2]
+            for entry in range(offset, offset + size, entsize):
+                if self.wide:
+                    name_offset, _, _, _, value, _ = struct.unpack_from("<IBBHQQ", self.data, entry)
+                else:
+                    name_offset, value, _, _, _, _ = struct.unpack_from("<IIIBBH", self.data, entry)
+                start = strtab + name_offset
+                if self.data[start:self.data.index(b"\0", start)] == name:
+                    return value
+        return None
+
+    def string(self, address):
+        """The NUL terminated string stored at an address, or None."""
+        for kind, addr, offset, size, _, _ in self.sections:
+            if kind != SHT_NOBITS and addr and addr <= address < addr + size:
+                start = offset + address - addr
+                end = self.data.index(b"\0", start)
+                return self.data[start:end].decode("utf-8", "replace")
+        return None
+
+
+def read_args(payload):
+    """Decode the typed arguments of one record."""
+    args = []
+    i = 0
+    while i < len(payload):
+        kind = chr(payload[i])
+        i += 1
+        if kind == "s":
+            length = payload[i]
+            args.append(payload[i + 1:i + 1 + length].decode("utf-8", "replace"))
+            i += 1 + length
+        else:
+            layout = {"i": "<i", "u": "<I", "I": "<q", "U": "<Q", "f": "<d", "p": "<Q"}[kind]
+            args.append(struct.unpack_from(layout, payload, i)[0])
+            i += struct.calcsize(layout)
+    return args
+
+
+def format_message(fmt, args):
+    """Apply a printf format with Python's % operator."""
+    values = []
+    missing = False
+
+    def convert(match):
+        nonlocal missing
+        flags, width, precision, length, conversion = match.groups()
+        for part in (width, precision):
+            if part and part.endswith("*"):
+                values.append(args.pop(0) if args else 0)
+        if not args:
+            # Arguments that did not fit in the record
+            missing = True
+            return "?"
+        value = args.pop(0)
+        if conversion == "p":
+            values.append(value)
+            return "0x%x"
+        if conversion in "ouxX" and isinstance(value, int) and value < 0:
+            value += 1 << (64 if length in ("ll", "j") else 32)
+        if conversion == "c" and isinstance(value, int):
+            value = chr(value & 0xFF)
+        values.append(value)
+        return "%" + flags + (width or "") + (precision or "") + ("d" if conversion in "iu" else conversion)
+
+    # A literal %% must not be taken for the start of a conversion
+    python_format = CONVERSION.sub(convert, fmt.replace("%%", "\0"))
+    text = python_format.replace("\0", "%%") % tuple(values)
+    return text + (" [truncated]" if missing else "")
+
+
+def decode(elf, log, out):
+    data = log.read()
+    if data[:4] != MAGIC:
+        raise ValueError("not a DeferredLog file")
+    version, anchor = struct.unpack_from("<IQ", data, 4)
+    if version != VERSION:
+        raise ValueError(f"log version {version}, expected {VERSION}")
+
+    # A position independent host build loads at a different address every run
+    elf_anchor = elf.symbol(ANCHOR_SYMBOL)
+    if elf_anchor is None:
+        raise ValueError("the ELF file has no deferred_log_anchor symbol")
+    bias = anchor - elf_anchor
+
+    strings = {}
+
+    def lookup(address):
+        if address not in strings:
+            text = elf.string(address - bias)
+            strings[address] = text if text is not None else f"<unknown 0x{address:x}>"
+        return strings[address]
+
+    i = 16
+    while i + 22 <= len(data):
+        fmt, tag, timestamp, level, length = struct.unpack_from("<QQIBB", data, i)
+        payload = data[i + 22:i + 22 + length]
+        i += 22 + length
+        message = format_message(lookup(fmt), read_args(payload))
+        out.write(f"{LEVELS.get(level, '?')} ({timestamp}) {lookup(tag)}: {message}\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode a DeferredLog binary log")
+    parser.add_argument("elf", help="firmware ELF, or host executable, that wrote the log")
+    parser.add_argument("log", help="binary log file")
+    args = parser.parse_args()
+
+    with open(args.log, "rb") as log:
+        decode(Elf(args.elf), log, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
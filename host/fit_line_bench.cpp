@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "moments.hpp"
+#ifndef CAMERA_NO_OPENCV
+#include <opencv2/imgproc.hpp>
+#endif
+
+/*
+ * Times Vision::fit_line against the floating point fit it replaces and
+ * reports its angle error, as JSON. The blobs are random thick line segments
+ * like the ones the white line detector sees. The reference is the DIST_L2
+ * fit in double: the principal axis of the central second moments, which is
+ * what cv::fitLine converges to. With OpenCV, cv::moments and cv::fitLine
+ * are timed on the same blobs and their angle is compared as well.
+ */
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int SIZE = 96;
+
+    struct Run {
+        int y;
+        int x0;
+        int x1;
+    };
+
+    struct Sample {
+        std::vector<Run> runs;
+        Vision::Moments moments;
+        double angle = 0;   ///< Reference angle in radians, within (-pi/2, pi/2]
+    };
+
+    void usage(const char* program)
+    {
+        fprintf(stderr,
+                "Usage: %s [--blobs N] [--iterations K]\n"
+                "\n"
+                "  --blobs N       Random blobs to fit (default 2000)\n"
+                "  --iterations K  Passes over the blobs when timing (default 200)\n",
+                program);
+    }
+
+    // A segment of 2 to 41 rows with a random slope and width, in the lower half of the frame
+    std::vector<Run> random_blob(std::mt19937& rng)
+    {
+        std::vector<Run> runs;
+        const int rows = 2 + rng() % 40;
+        const double slope = static_cast<int>(rng() % 200 - 100) / 25.0;
+        for (int y = 0; y < rows; y++) {
+            const int center = SIZE / 2 + static_cast<int>(slope * (y - rows / 2));
+            const int half_width = 1 + rng() % 5;
+            const int x0 = std::max(center - half_width, 0);
+            const int x1 = std::min(center + half_width, SIZE);
+            if (x0 < x1) {
+                runs.push_back({SIZE / 2 + y, x0, x1});
+            }
+        }
+        return runs;
+    }
+
+    // The DIST_L2 line in double, from sums over the pixels
+    double reference_angle(const std::vector<Run>& runs, double& center_x)
+    {
+        double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0, syy = 0;
+        for (const Run& run : runs) {
+            for (int x = run.x0; x < run.x1; x++) {
+                n++;
+                sx += x;
+                sy += run.y;
+                sxx += static_cast<double>(x) * x;
+                sxy += static_cast<double>(x) * run.y;
+                syy += static_cast<double>(run.y) * run.y;
+            }
+        }
+        const double mx = sx / n;
+        const double my = sy / n;
+        center_x = mx;
+        return 0.5 * atan2(2 * (sxy / n - mx * my), (sxx / n - mx * mx) - (syy / n - my * my));
+    }
+
+    // Difference between two axis angles, which are the same modulo pi
+    double axis_error(double a, double b)
+    {
+        const double error = fabs(a - b);
+        return fmin(error, M_PI - error);
+    }
+
+    // Time one fit over every sample K times and return the ns per fit
+    template <typename Fit>
+    double time_fit(const std::vector<Sample>& samples, int iterations, Fit fit)
+    {
+        volatile int32_t sink = 0;
+        const Clock::time_point start = Clock::now();
+        for (int i = 0; i < iterations; i++) {
+            for (const Sample& sample : samples) {
+                sink = sink + fit(sample);
+            }
+        }
+        const double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        return elapsed / (static_cast<double>(iterations) * samples.size());
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    int blob_count = 2000;
+    int iterations = 200;
+    for (int i = 1; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--blobs") == 0 && has_value) {
+            blob_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--iterations") == 0 && has_value) {
+            iterations = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (blob_count <= 0 || iterations <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // Blobs with no single axis (a square, or a lone pixel) have no angle to compare
+    std::mt19937 rng(17);
+    std::vector<Sample> samples;
+    while (static_cast<int>(samples.size()) < blob_count) {
+        Sample sample;
+        sample.runs = random_blob(rng);
+        sample.moments = {};
+        for (const Run& run : sample.runs) {
+            sample.moments.add_run(run.y, run.x0, run.x1);
+        }
+        if (sample.moments.m00 == 0) {
+            continue;
+        }
+        const Vision::Moments& m = sample.moments;
+        const int64_t mu20 = static_cast<int64_t>(m.m20) * m.m00 - static_cast<int64_t>(m.m10) * m.m10;
+        const int64_t mu11 = static_cast<int64_t>(m.m11) * m.m00 - static_cast<int64_t>(m.m10) * m.m01;
+        const int64_t mu02 = static_cast<int64_t>(m.m02) * m.m00 - static_cast<int64_t>(m.m01) * m.m01;
+        if (mu11 == 0 && mu20 == mu02) {
+            continue;
+        }
+        samples.push_back(sample);
+    }
+
+    // Accuracy of the fixed point fit
+    double worst_angle = 0;
+    double total_angle = 0;
+    double worst_direction = 0;
+    double worst_center = 0;
+    for (Sample& sample : samples) {
+        double center_x;
+        sample.angle = reference_angle(sample.runs, center_x);
+        const Vision::LineFit fit = Vision::fit_line(sample.moments);
+        const double angle = fit.angle_q16 / 65536.0;
+        const double error = axis_error(angle, sample.angle);
+        worst_angle = fmax(worst_angle, error);
+        total_angle += error;
+        worst_direction = fmax(worst_direction, fabs(fit.vx_q14 / 16384.0 - cos(angle))
+                                                    + fabs(fit.vy_q14 / 16384.0 - sin(angle)));
+        worst_center = fmax(worst_center, fabs(fit.x0_q8 / 256.0 - center_x));
+    }
+
+    // Both start from the runs, as the labeler sees them
+    const double fixed_ns = time_fit(samples, iterations, [](const Sample& sample) {
+        Vision::Moments moments = {};
+        for (const Run& run : sample.runs) {
+            moments.add_run(run.y, run.x0, run.x1);
+        }
+        return Vision::fit_line(moments).angle_q16;
+    });
+    const double float_ns = time_fit(samples, iterations, [](const Sample& sample) {
+        double center_x;
+        return static_cast<int32_t>(reference_angle(sample.runs, center_x) * 65536.0);
+    });
+
+    printf("{\"blobs\": %zu, \"fit_line_ns\": %.1f, \"float_ns\": %.1f, "
+           "\"max_angle_error_deg\": %.4f, \"mean_angle_error_deg\": %.4f, "
+           "\"max_direction_error\": %.5f, \"max_center_error_px\": %.4f",
+           samples.size(), fixed_ns, float_ns, worst_angle * 180 / M_PI,
+           total_angle / samples.size() * 180 / M_PI, worst_direction, worst_center);
+
+#ifndef CAMERA_NO_OPENCV
+    // cv::fitLine works on the points of the blob rather than its moments
+    double worst_cv_angle = 0;
+    for (const Sample& sample : samples) {
+        std::vector<cv::Point> points;
+        for (const Run& run : sample.runs) {
+            for (int x = run.x0; x < run.x1; x++) {
+                points.emplace_back(x, run.y);
+            }
+        }
+        cv::Vec4f line;
+        cv::fitLine(points, line, cv::DIST_L2, 0, 0.01, 0.01);
+        worst_cv_angle = fmax(worst_cv_angle, axis_error(atan2(line[1], line[0]), sample.angle));
+    }
+    // Includes building the mask and point list the two calls need
+    const double opencv_ns = time_fit(samples, iterations, [](const Sample& sample) {
+        cv::Mat mask = cv::Mat::zeros(SIZE, SIZE, CV_8UC1);
+        std::vector<cv::Point> points;
+        for (const Run& run : sample.runs) {
+            for (int x = run.x0; x < run.x1; x++) {
+                mask.at<uint8_t>(run.y, x) = 255;
+                points.emplace_back(x, run.y);
+            }
+        }
+        const cv::Moments moments = cv::moments(mask, true);
+        cv::Vec4f line;
+        cv::fitLine(points, line, cv::DIST_L2, 0, 0.01, 0.01);
+        return static_cast<int32_t>(moments.m00 + line[0] * 65536.0f);
+    });
+    printf(", \"opencv_ns\": %.1f, \"opencv_max_angle_error_deg\": %.4f", opencv_ns,
+           worst_cv_angle * 180 / M_PI);
+#endif
+    printf("}\n");
+    return 0;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "driver/gpio.h"
+#include "driver/sdmmc_types.h"
+
+/// @brief Host stand-in for the SD/MMC slot configuration; nothing in it is used
+typedef struct {
+    uint8_t width;
+    uint32_t flags;
+} sdmmc_slot_config_t;
+
+#define SDMMC_HOST_DEFAULT() sdmmc_host_t{0, 1, 20000}
+#define SDMMC_SLOT_CONFIG_DEFAULT() sdmmc_slot_config_t{4, 0}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+/// @brief Host stand-in for the SD/MMC host configuration; nothing in it is used
+typedef struct {
+    uint32_t flags;
+    int slot;
+    int max_freq_khz;
+} sdmmc_host_t;
+
+/// @brief Host stand-in for a detected card
+typedef struct {
+    const char* path;   ///< Host directory the card is backed by
+} sdmmc_card_t;
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Host stand-in for the CPU cycle counter
+ *
+ * The "cycles" are nanoseconds of the host's steady clock. The host has no
+ * pinned cores, so every thread reports core 0.
+ */
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+/// @brief Low 32 bits of the steady clock in nanoseconds, wrapping like CCOUNT
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count();
+
+/// @brief The core the caller runs on, always 0
+inline int esp_cpu_get_core_id() { return 0; }
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include "esp_err.h"
+
+/**
+ * @brief Host stand-in for ESP-IDF logging
+ *
+ * Lines are written to stderr in the same "I (ms) TAG: message" layout as
+ * the serial console, so host and device logs can be compared directly and
+ * stay apart from the reports the host tools print.
+ */
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+/// @brief Set the most verbose level printed. Only the "*" tag is supported.
+void esp_log_level_set(const char* tag, esp_log_level_t level);
+
+/// @brief Milliseconds since the program started
+uint32_t esp_log_timestamp();
+
+/// @brief Print a formatted log line if level is enabled
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#define ESP_LOG_FORMAT(letter, format) #letter " (%lu) %s: " format "\n"
+
+#define ESP_LOGE(tag, format, ...) esp_log_write(ESP_LOG_ERROR, tag, ESP_LOG_FORMAT(E, format), (unsigned long)esp_log_timestamp(), tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) esp_log_write(ESP_LOG_WARN, tag, ESP_LOG_FORMAT(W, format), (unsigned long)esp_log_timestamp(), tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) esp_log_write(ESP_LOG_INFO, tag, ESP_LOG_FORMAT(I, format), (unsigned long)esp_log_timestamp(), tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) esp_log_write(ESP_LOG_DEBUG, tag, ESP_LOG_FORMAT(D, format), (unsigned long)esp_log_timestamp(), tag, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) esp_log_write(ESP_LOG_VERBOSE, tag, ESP_LOG_FORMAT(V, format), (unsigned long)esp_log_timestamp(), tag, ##__VA_ARGS__)
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstdint>
+
+/// @brief Rate of esp_cpu_get_cycle_count(), which counts nanoseconds on the host
+inline uint32_t esp_rom_get_cpu_ticks_per_us() { return 1000; }
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstdint>
+
+/// @brief Microseconds since the program started, from the host's steady clock
+int64_t esp_timer_get_time();
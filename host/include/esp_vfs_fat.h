@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_err.h"
+#include "driver/sdmmc_host.h"
+
+/**
+ * @brief Host stand-in for the FAT filesystem on the SD card
+ *
+ * The "card" is a directory on the host named by the mount point, so the
+ * firmware's stdio and POSIX file calls work on it unchanged.
+ */
+
+typedef struct {
+    bool format_if_mount_failed;
+    int max_files;
+    size_t allocation_unit_size;
+    bool disk_status_check_enable;
+} esp_vfs_fat_mount_config_t;
+
+typedef esp_vfs_fat_mount_config_t esp_vfs_fat_sdmmc_mount_config_t;
+
+/// @brief Create the mount point directory if it is missing and treat it as the card
+esp_err_t esp_vfs_fat_sdmmc_mount(const char* base_path, const sdmmc_host_t* host_config,
+                                  const void* slot_config, const esp_vfs_fat_mount_config_t* mount_config,
+                                  sdmmc_card_t** out_card);
+
+/// @brief Forget the mounted card
+esp_err_t esp_vfs_fat_sdmmc_unmount();
+
+/// @brief Create a file and reserve size bytes for it
+esp_err_t esp_vfs_fat_create_contiguous_file(const char* base_path, const char* full_path, uint64_t size,
+                                             bool alloc_now);
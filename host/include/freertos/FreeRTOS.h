@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Host stand-in for the FreeRTOS kernel types
+ *
+ * Tasks run on std::thread and queues are guarded by a mutex, so the
+ * firmware's task code runs unchanged on the host. The tick is 1 ms.
+ */
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define configTICK_RATE_HZ      1000
+#define portTICK_PERIOD_MS      (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY           ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(((TickType_t)(ms) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+
+#define pdFALSE     ((BaseType_t)0)
+#define pdTRUE      ((BaseType_t)1)
+#define pdPASS      pdTRUE
+#define pdFAIL      pdFALSE
+
+// esp_cpu_get_core_id() always reports core 0
+#define portNUM_PROCESSORS  1
+
+#define tskNO_AFFINITY  ((BaseType_t)0x7FFFFFFF)
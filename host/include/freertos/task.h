@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+
+typedef struct tskTaskControlBlock* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+/**
+ * @brief Start a task on a new thread
+ *
+ * The stack size and priority are ignored. xPortGetCoreID() in the task
+ * returns core_id, so per-core data is laid out as on the device.
+ */
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_depth,
+                                   void* parameters, UBaseType_t priority, TaskHandle_t* created_task,
+                                   BaseType_t core_id);
+
+/// @brief End a task. Only a task ending itself (nullptr) is supported.
+void vTaskDelete(TaskHandle_t task);
+
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+
+/// @brief Core the calling task was pinned to, 0 for threads not started as tasks
+BaseType_t xPortGetCoreID();
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <esp_err.h>
+
+/**
+ * @brief Controls for the replayed camera of the host simulator
+ */
+namespace HostCamera {
+
+    /// @brief Tag used in ESP debug logs
+    static const char* TAG = "HOST_CAMERA";
+
+    /// @brief How long esp_camera_fb_get() waits for a frame before giving up, as the driver does
+    constexpr int FB_GET_TIMEOUT_MS = 4000;
+
+    /// @brief Width and height of the replayed frames (FRAMESIZE_96X96)
+    constexpr int FRAME_SIZE = 96;
+
+    /// @brief How the captures are replayed
+    struct Config {
+        const char* directory = ".";    ///< Directory holding the IMAGE*.BIN captures
+        int fps = 0;                    ///< Frames per second to deliver, 0 for as fast as they are taken
+        bool loop = false;              ///< Start over after the last capture instead of running dry
+    };
+
+    /**
+     * @brief Load every capture in a directory into memory, in image number order
+     *
+     * Files that are not a raw 96x96 RGB565 frame are skipped with a warning.
+     * Loading up front keeps disk reads out of the measured frame path.
+     *
+     * @param config - Where the captures are and how to replay them
+     * @return esp_err_t - ESP_OK if at least one capture was loaded
+     */
+    esp_err_t configure(const Config& config);
+
+    /// @brief Number of captures loaded
+    size_t frame_count();
+
+    /// @brief Number of frames handed out by esp_camera_fb_get() so far
+    uint64_t frames_delivered();
+
+    /// @brief Replay the captures from the first one again, as a sensor does after a reboot
+    void rewind();
+
+    /// @brief Copies made out of the driver's frame buffers
+    struct CopyStats {
+        uint64_t copies;    ///< memcpy() calls that read from a frame buffer
+        uint64_t bytes;     ///< Bytes those calls copied
+    };
+
+    /**
+     * @brief Copies made out of the frame buffers since the last reset_copy_stats()
+     *
+     * Only counted in programs linked with -Wl,--wrap=memcpy, which routes the
+     * memcpy() calls of the firmware through note_copy(). Elsewhere this stays
+     * zero.
+     *
+     * @return CopyStats - The number of copies and the bytes they moved
+     */
+    CopyStats copy_stats();
+
+    /// @brief Start counting copies from zero
+    void reset_copy_stats();
+
+    /**
+     * @brief Count a copy if its source lies in one of the driver's frame buffers
+     *
+     * @param source - Where the copy reads from
+     * @param length - Bytes copied
+     */
+    void note_copy(const void* source, size_t length);
+}
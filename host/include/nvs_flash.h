@@ -0,0 +1,10 @@
+#pragma once
+
+#include "esp_err.h"
+#include "nvs.h"
+
+/// @brief Open the directory standing in for the NVS partition
+esp_err_t nvs_flash_init();
+
+/// @brief Delete everything stored in NVS
+esp_err_t nvs_flash_erase();
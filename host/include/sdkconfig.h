@@ -0,0 +1,3 @@
+#pragma once
+
+// Nothing from this header is used on the host
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdio>
+#include "driver/sdmmc_types.h"
+
+/// @brief Print what the card is, here the directory standing in for it
+void sdmmc_card_print_info(FILE* stream, const sdmmc_card_t* card);
@@ -0,0 +1,51 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "deferred_log.hpp"
+
+/*
+ * Measures what a log call costs on the frame path: ESP_LOGI, which formats
+ * and prints the line, against DLOGI, which only queues the raw arguments.
+ */
+
+namespace {
+    void usage(const char* program)
+    {
+        fprintf(stderr,
+                "Usage: %s [--calls N] [--out FILE]\n"
+                "\n"
+                "  --calls N   Calls to time of each kind (default 10000)\n"
+                "  --out FILE  Binary log the DLOGI calls are written to (default bench.log)\n"
+                "\n"
+                "The ESP_LOGI lines go to stderr; redirect it to compare consoles.\n",
+                program);
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    int calls = 10000;
+    const char* out = "bench.log";
+    for (int i = 1; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--calls") == 0 && has_value) {
+            calls = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--out") == 0 && has_value) {
+            out = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (DeferredLog::start(out) != ESP_OK) {
+        return 1;
+    }
+    const DeferredLog::Benchmark result = DeferredLog::log_benchmark(calls);
+    DeferredLog::stop();
+
+    printf("{\"calls\": %d, \"esp_log_ns\": %lu, \"deferred_ns\": %lu}\n", calls,
+           (unsigned long)result.esp_log_ns, (unsigned long)result.deferred_ns);
+    return result.deferred_ns || result.esp_log_ns ? 0 : 1;
+}
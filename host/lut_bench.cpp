@@ -0,0 +1,106 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "class_lut.hpp"
+#include "swar.hpp"
+#include "vision.hpp"
+
+/*
+ * Times classifying whole frames with ClassLut against evaluating the colour
+ * predicates, one pixel at a time and two at a time with Swar, and prints the
+ * cost per pixel as JSON. The frames hold random codes, so every lookup can
+ * land anywhere in the 64 KB table.
+ */
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int SIZE = 96;
+    constexpr int PIXELS = SIZE * SIZE;
+    constexpr int FRAME_COUNT = 16;
+
+    void usage(const char* program)
+    {
+        fprintf(stderr,
+                "Usage: %s [--iterations K]\n"
+                "\n"
+                "  --iterations K  Passes over %d random frames for each method (default 200)\n",
+                program, FRAME_COUNT);
+    }
+
+    // Run one method over every frame K times and return the ns per pixel;
+    // classes is left holding the class bits of every frame
+    template <typename ClassifyRow>
+    double time_method(const std::vector<uint8_t>& frames, int iterations, std::vector<uint8_t>& classes,
+                       ClassifyRow classify_row)
+    {
+        classes.assign(PIXELS * FRAME_COUNT, 0);
+        const Clock::time_point start = Clock::now();
+        for (int i = 0; i < iterations; i++) {
+            for (int f = 0; f < FRAME_COUNT; f++) {
+                const uint8_t* frame = &frames[2 * PIXELS * f];
+                uint8_t* out = &classes[PIXELS * f];
+                for (int y = 0; y < SIZE; y++) {
+                    classify_row(frame + 2 * SIZE * y, out + SIZE * y);
+                }
+            }
+        }
+        const double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        return elapsed / (static_cast<double>(iterations) * FRAME_COUNT * PIXELS);
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    int iterations = 200;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (iterations <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::mt19937 rng(13);
+    std::vector<uint8_t> frames(2 * PIXELS * FRAME_COUNT);
+    for (uint8_t& byte : frames) {
+        byte = static_cast<uint8_t>(rng());
+    }
+    const uint8_t* lut = ClassLut::table();
+
+    std::vector<uint8_t> predicates_classes;
+    std::vector<uint8_t> swar_classes;
+    std::vector<uint8_t> lut_classes;
+    const auto predicates = [](const uint8_t* px, uint8_t* out) {
+        for (int x = 0; x < SIZE; x++, px += 2) {
+            out[x] = Vision::classify(RGB565::code(px));
+        }
+    };
+    const auto swar = [](const uint8_t* px, uint8_t* out) {
+        Swar::classify_row(px, SIZE, out);
+    };
+    const auto lookup = [lut](const uint8_t* px, uint8_t* out) {
+        for (int x = 0; x < SIZE; x++, px += 2) {
+            out[x] = lut[RGB565::code(px)];
+        }
+    };
+    const double predicates_ns = time_method(frames, iterations, predicates_classes, predicates);
+    const double swar_ns = time_method(frames, iterations, swar_classes, swar);
+    const double lut_ns = time_method(frames, iterations, lut_classes, lookup);
+
+    const bool same = predicates_classes == swar_classes && swar_classes == lut_classes;
+    printf("{\"pixels\": %lld, \"predicates_ns_per_px\": %.3f, \"swar_ns_per_px\": %.3f, "
+           "\"lut_ns_per_px\": %.3f, \"lut_bytes\": %u, \"results_match\": %s}\n",
+           static_cast<long long>(iterations) * FRAME_COUNT * PIXELS, predicates_ns, swar_ns, lut_ns,
+           static_cast<unsigned>(ClassLut::SIZE), same ? "true" : "false");
+    return same ? 0 : 1;
+}
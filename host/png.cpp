@@ -0,0 +1,100 @@
+#include "png.hpp"
+
+#include <cstdio>
+#include <vector>
+
+namespace {
+    // Largest block of a stored (uncompressed) deflate stream
+    constexpr size_t STORED_BLOCK = 65535;
+
+    uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0)
+    {
+        // Built once, safely even when several threads write images
+        struct Table {
+            uint32_t entries[256];
+            Table() {
+                for (uint32_t n = 0; n < 256; n++) {
+                    uint32_t c = n;
+                    for (int k = 0; k < 8; k++) {
+                        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                    }
+                    entries[n] = c;
+                }
+            }
+        };
+        static const Table table;
+        crc = ~crc;
+        for (size_t i = 0; i < length; i++) {
+            crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    uint32_t adler32(const uint8_t* data, size_t length)
+    {
+        uint32_t a = 1;
+        uint32_t b = 0;
+        for (size_t i = 0; i < length; i++) {
+            a = (a + data[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    void put_u32(std::vector<uint8_t>& out, uint32_t value)
+    {
+        out.push_back(value >> 24);
+        out.push_back(value >> 16);
+        out.push_back(value >> 8);
+        out.push_back(value);
+    }
+
+    bool write_chunk(FILE* file, const char* type, const std::vector<uint8_t>& data)
+    {
+        std::vector<uint8_t> chunk;
+        put_u32(chunk, static_cast<uint32_t>(data.size()));
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+        put_u32(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+        return fwrite(chunk.data(), 1, chunk.size(), file) == chunk.size();
+    }
+}
+
+
+esp_err_t Png::write_rgb(const char* path, const uint8_t* rgb, int width, int height)
+{
+    // Every row starts with filter type 0 (none)
+    std::vector<uint8_t> raw;
+    raw.reserve(static_cast<size_t>(height) * (3 * width + 1));
+    for (int y = 0; y < height; y++) {
+        raw.push_back(0);
+        raw.insert(raw.end(), rgb + 3 * y * width, rgb + 3 * (y + 1) * width);
+    }
+
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    for (size_t pos = 0; pos < raw.size() || pos == 0; pos += STORED_BLOCK) {
+        const size_t length = raw.size() - pos < STORED_BLOCK ? raw.size() - pos : STORED_BLOCK;
+        zlib.push_back(pos + length >= raw.size() ? 1 : 0);
+        zlib.push_back(length & 0xFF);
+        zlib.push_back(length >> 8);
+        zlib.push_back(~length & 0xFF);
+        zlib.push_back((~length >> 8) & 0xFF);
+        zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + length);
+    }
+    put_u32(zlib, adler32(raw.data(), raw.size()));
+
+    std::vector<uint8_t> header;
+    put_u32(header, width);
+    put_u32(header, height);
+    header.insert(header.end(), {8, 2, 0, 0, 0});  // 8 bit RGB, no interlace
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return ESP_FAIL;
+    }
+    static const uint8_t SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    const bool written = fwrite(SIGNATURE, 1, sizeof(SIGNATURE), file) == sizeof(SIGNATURE) &&
+                         write_chunk(file, "IHDR", header) && write_chunk(file, "IDAT", zlib) &&
+                         write_chunk(file, "IEND", {});
+    return (fclose(file) == 0 && written) ? ESP_OK : ESP_FAIL;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <esp_err.h>
+
+/**
+ * @brief Minimal PNG writer for the host tools' overlay images
+ *
+ * The image data is stored uncompressed inside the zlib stream, so no
+ * compression library is needed. Files are larger than usual but open in
+ * any viewer.
+ */
+namespace Png {
+
+    /**
+     * @brief Write an 8 bit RGB image
+     *
+     * @param path - File to create
+     * @param rgb - Pixels row by row, three bytes each
+     * @param width - Width of the image in pixels
+     * @param height - Height of the image in pixels
+     * @return esp_err_t - ESP_OK if the file was written
+     */
+    esp_err_t write_rgb(const char* path, const uint8_t* rgb, int width, int height);
+}
@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include "class_lut.hpp"
+#include "dataset.hpp"
+#include "vision.hpp"
+
+/*
+ * Replays a recorded dataset through the detection pipeline and prints the
+ * throughput and per-stage latency as JSON, for comparing commits.
+ */
+
+namespace {
+    const char* TAG = "REPLAY_BENCH";
+
+    using Clock = std::chrono::steady_clock;
+
+    std::atomic<uint64_t> allocations{0};
+
+    enum Stage {
+        STAGE_SEGMENT,
+        STAGE_BOXES,
+        STAGE_WHITE_LINE,
+        STAGE_FRAME,
+        STAGE_COUNT,
+    };
+
+    const char* const STAGE_NAMES[STAGE_COUNT] = {"segment", "boxes", "white_line", "frame"};
+
+    struct Options {
+        const char* dataset = nullptr;
+        const char* label = "";
+        const char* out = nullptr;
+        int iterations = 10;
+        bool direct = false;
+        bool lut = true;
+        bool tracking = false;
+    };
+
+    // What a frame cost besides time
+    struct Work {
+        uint32_t bytes_read;    ///< Bytes of the frame read by the detectors
+        int pixels_touched;     ///< Pixels the white line search visited
+        int search_area;        ///< Pixels a full white line search visits
+    };
+
+    struct Summary {
+        double mean_us;
+        double p50_us;
+        double p99_us;
+        double max_us;
+    };
+
+    // The detector state is large, so it lives outside the stack
+    Vision::Segmentation segmentation;
+    Vision::Integrals integrals;
+    Vision::WhiteLineDetector detector;
+
+    void usage(const char* program)
+    {
+        fprintf(stderr,
+                "Usage: %s DATASET [--iterations K] [--direct] [--no-lut] [--tracking] [--label TEXT] [--out FILE]\n"
+                "\n"
+                "DATASET is a directory of IMAGE*.BIN captures or a container file.\n"
+                "  --iterations K  Passes over the dataset (default 10)\n"
+                "  --direct        Run each detector on the frame instead of one fused segment() pass\n"
+                "  --no-lut        Classify pixels with the predicates instead of ClassLut\n"
+                "  --tracking      Track the white line between frames\n"
+                "  --label TEXT    Copied into the report, e.g. a commit id\n"
+                "  --out FILE      Write the report to FILE instead of stdout\n",
+                program);
+    }
+
+    bool parse(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; i++) {
+            const bool has_value = i + 1 < argc;
+            if (strcmp(argv[i], "--iterations") == 0 && has_value) {
+                options.iterations = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "--direct") == 0) {
+                options.direct = true;
+            } else if (strcmp(argv[i], "--no-lut") == 0) {
+                options.lut = false;
+            } else if (strcmp(argv[i], "--tracking") == 0) {
+                options.tracking = true;
+            } else if (strcmp(argv[i], "--label") == 0 && has_value) {
+                options.label = argv[++i];
+            } else if (strcmp(argv[i], "--out") == 0 && has_value) {
+                options.out = argv[++i];
+            } else if (argv[i][0] != '-' && !options.dataset) {
+                options.dataset = argv[i];
+            } else {
+                return false;
+            }
+        }
+        return options.dataset && options.iterations > 0;
+    }
+
+    uint32_t elapsed_ns(Clock::time_point from, Clock::time_point to)
+    {
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+    }
+
+    // Run the pipeline on one frame, recording the time of each stage and the work done
+    uint32_t run_frame(const Vision::Frame& frame, const Options& options, const uint8_t* lut, uint32_t* times,
+                       Work& work)
+    {
+        Vision::BoxResult stop;
+        Vision::BoxResult car;
+        Vision::SteeringResult line;
+
+        const Clock::time_point start = Clock::now();
+        Clock::time_point segmented = start;
+        Clock::time_point boxed;
+        if (options.direct) {
+            stop = Vision::detect_stop_box(frame);
+            car = Vision::detect_car_box(frame);
+            boxed = Clock::now();
+            line = detector.detect(frame);
+            work.bytes_read = 2 * (stop.pixels_read + car.pixels_read + line.pixels_touched);
+        } else {
+            Vision::segment(frame, segmentation, lut, &integrals);
+            segmented = Clock::now();
+            stop = segmentation.stop_box();
+            car = segmentation.car_box();
+            boxed = Clock::now();
+            line = detector.detect(segmentation);
+            work.bytes_read = segmentation.bytes_read;
+        }
+        const Clock::time_point end = Clock::now();
+        work.pixels_touched = line.pixels_touched;
+        work.search_area = line.search_area;
+
+        times[STAGE_SEGMENT] = elapsed_ns(start, segmented);
+        times[STAGE_BOXES] = elapsed_ns(segmented, boxed);
+        times[STAGE_WHITE_LINE] = elapsed_ns(boxed, end);
+        times[STAGE_FRAME] = elapsed_ns(start, end);
+
+        // Folded into a checksum so a change in the results shows up in the report
+        return (stop.triggered ? 1u : 0u) | (car.triggered ? 2u : 0u) |
+               (static_cast<uint32_t>(line.steering + 128) << 2) | (static_cast<uint32_t>(line.area) << 10);
+    }
+
+    // Print a string as a JSON string literal
+    void print_string(FILE* out, const char* text)
+    {
+        fputc('"', out);
+        for (const char* c = text; *c; c++) {
+            if (*c == '"' || *c == '\\') {
+                fputc('\\', out);
+            }
+            if (static_cast<unsigned char>(*c) >= 0x20) {
+                fputc(*c, out);
+            }
+        }
+        fputc('"', out);
+    }
+
+    Summary summarize(std::vector<uint32_t>& samples)
+    {
+        std::sort(samples.begin(), samples.end());
+        double total = 0;
+        for (uint32_t sample : samples) {
+            total += sample;
+        }
+        const size_t n = samples.size();
+        return {total / n / 1000.0, samples[(n - 1) * 50 / 100] / 1000.0, samples[(n - 1) * 99 / 100] / 1000.0,
+                samples[n - 1] / 1000.0};
+    }
+}
+
+
+// Count every heap allocation the pipeline makes
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parse(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    std::vector<Dataset::Frame> frames;
+    if (Dataset::load(options.dataset, frames) != ESP_OK) {
+        return 1;
+    }
+    ClassLut::init(ClassLut::Placement::Flash);
+    const uint8_t* lut = options.lut ? ClassLut::table() : nullptr;
+    detector.set_tracking(options.tracking);
+
+    const size_t runs = frames.size() * options.iterations;
+    std::vector<uint32_t> samples[STAGE_COUNT];
+    for (std::vector<uint32_t>& stage : samples) {
+        stage.resize(runs);
+    }
+
+    // One untimed pass to warm the caches and the lookup table
+    uint32_t times[STAGE_COUNT];
+    Work work;
+    for (const Dataset::Frame& frame : frames) {
+        run_frame(frame.view(), options, lut, times, work);
+    }
+    detector.reset_track();
+
+    const uint64_t allocations_before = allocations.load() + heap_caps_allocation_count();
+    uint32_t checksum = 0;
+    uint64_t bytes_read = 0;
+    uint64_t frame_bytes = 0;
+    uint64_t pixels_touched = 0;
+    uint64_t search_area = 0;
+    double touched_fraction = 0;
+    size_t run = 0;
+    const Clock::time_point start = Clock::now();
+    for (int iteration = 0; iteration < options.iterations; iteration++) {
+        for (const Dataset::Frame& frame : frames) {
+            checksum = checksum * 31 + run_frame(frame.view(), options, lut, times, work);
+            bytes_read += work.bytes_read;
+            frame_bytes += frame.pixels.size();
+            pixels_touched += work.pixels_touched;
+            search_area += work.search_area;
+            touched_fraction += work.search_area > 0 ? static_cast<double>(work.pixels_touched) / work.search_area : 0;
+            for (int stage = 0; stage < STAGE_COUNT; stage++) {
+                samples[stage][run] = times[stage];
+            }
+            run++;
+        }
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    const uint64_t allocated = allocations.load() + heap_caps_allocation_count() - allocations_before;
+
+    FILE* out = options.out ? fopen(options.out, "w") : stdout;
+    if (!out) {
+        ESP_LOGE(TAG, "Cannot write %s", options.out);
+        return 1;
+    }
+    fprintf(out, "{\n");
+    fprintf(out, "  \"label\": ");
+    print_string(out, options.label);
+    fprintf(out, ",\n  \"dataset\": ");
+    print_string(out, options.dataset);
+    fprintf(out, ",\n");
+    fprintf(out, "  \"frames\": %u,\n", (unsigned)frames.size());
+    fprintf(out, "  \"iterations\": %d,\n", options.iterations);
+    fprintf(out, "  \"pipeline\": \"%s\",\n", options.direct ? "direct" : "fused");
+    fprintf(out, "  \"lut\": %s,\n", options.lut ? "true" : "false");
+    fprintf(out, "  \"tracking\": %s,\n", options.tracking ? "true" : "false");
+    fprintf(out, "  \"fps\": %.1f,\n", runs / seconds);
+    fprintf(out, "  \"allocations_per_frame\": %.3f,\n", static_cast<double>(allocated) / runs);
+    fprintf(out, "  \"frame_bytes\": %.1f,\n", static_cast<double>(frame_bytes) / runs);
+    fprintf(out, "  \"bytes_read_per_frame\": %.1f,\n", static_cast<double>(bytes_read) / runs);
+    fprintf(out, "  \"pixels_touched_per_frame\": %.1f,\n", static_cast<double>(pixels_touched) / runs);
+    fprintf(out, "  \"search_area_per_frame\": %.1f,\n", static_cast<double>(search_area) / runs);
+    fprintf(out, "  \"pixels_touched_fraction\": %.4f,\n", touched_fraction / runs);
+    fprintf(out, "  \"checksum\": \"%08x\",\n", (unsigned)checksum);
+    fprintf(out, "  \"stages\": {\n");
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        const Summary s = summarize(samples[stage]);
+        fprintf(out, "    \"%s\": {\"mean_us\": %.3f, \"p50_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f}%s\n",
+                STAGE_NAMES[stage], s.mean_us, s.p50_us, s.p99_us, s.max_us, stage + 1 < STAGE_COUNT ? "," : "");
+    }
+    fprintf(out, "  }\n}\n");
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
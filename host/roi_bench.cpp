@@ -0,0 +1,178 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "vision.hpp"
+
+/*
+ * Times counting the pixels of one class inside a set of regions, per pixel
+ * over the class bytes of a segmentation against popcounting the words of
+ * its BitMask, four lookups in its summed-area table, and RoiSet::evaluate
+ * over the regions split into sets of at most MAX_ROIS, and prints the cost
+ * per region query as JSON. Building the table is timed on its own, as it is
+ * paid once per frame however many regions are queried. The regions are
+ * random boxes with unaligned edges.
+ */
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int SIZE = 96;
+    constexpr int FRAME_COUNT = 16;
+
+    struct Options {
+        int rois = 16;
+        int iterations = 2000;
+    };
+
+    void usage(const char* program)
+    {
+        fprintf(stderr,
+                "Usage: %s [--rois N] [--iterations K]\n"
+                "\n"
+                "  --rois N        Regions queried per frame (default 16)\n"
+                "  --iterations K  Passes over %d random frames for each method (default 2000)\n",
+                program, FRAME_COUNT);
+    }
+
+    // The class bytes, white mask and summed-area tables of a random frame
+    struct Sample {
+        std::vector<uint8_t> classes;
+        Vision::Mask mask;
+        Vision::Integrals integrals;    ///< Only the white table is filled
+    };
+
+    // Run one method over every frame and region K times and return the ns per query;
+    // counts is left holding the count of every region of every frame
+    template <typename Count>
+    double time_method(const std::vector<Sample>& samples, const std::vector<Vision::Rect>& rois, int iterations,
+                       std::vector<int>& counts, Count count)
+    {
+        counts.assign(samples.size() * rois.size(), 0);
+        const Clock::time_point start = Clock::now();
+        for (int i = 0; i < iterations; i++) {
+            for (size_t f = 0; f < samples.size(); f++) {
+                for (size_t r = 0; r < rois.size(); r++) {
+                    counts[f * rois.size() + r] = count(samples[f], rois[r]);
+                }
+            }
+        }
+        const double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        return elapsed / (static_cast<double>(iterations) * samples.size() * rois.size());
+    }
+
+    // Time evaluating every set against every frame K times and return the ns per region
+    double time_sets(const std::vector<Sample>& samples, const std::vector<Vision::RoiSet>& sets, int rois,
+                     int iterations, std::vector<int>& counts)
+    {
+        counts.assign(samples.size() * rois, 0);
+        Vision::BoxResult results[Vision::RoiSet::MAX_ROIS];
+        const Clock::time_point start = Clock::now();
+        for (int i = 0; i < iterations; i++) {
+            for (size_t f = 0; f < samples.size(); f++) {
+                int r = 0;
+                for (const Vision::RoiSet& set : sets) {
+                    set.evaluate(samples[f].integrals, results);
+                    for (int j = 0; j < set.size(); j++) {
+                        counts[f * rois + r++] = results[j].count;
+                    }
+                }
+            }
+        }
+        const double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        return elapsed / (static_cast<double>(iterations) * samples.size() * rois);
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--rois") == 0 && has_value) {
+            options.rois = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--iterations") == 0 && has_value) {
+            options.iterations = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.rois <= 0 || options.iterations <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::mt19937 rng(14);
+    std::vector<Sample> samples(FRAME_COUNT);
+    for (Sample& sample : samples) {
+        sample.classes.resize(SIZE * SIZE);
+        sample.mask.clear();
+        for (int p = 0; p < SIZE * SIZE; p++) {
+            sample.classes[p] = rng() % 4 == 0 ? Vision::CLASS_WHITE : 0;
+            if (sample.classes[p]) {
+                sample.mask.set(p % SIZE, p / SIZE);
+            }
+        }
+        sample.integrals.white.build(sample.mask);
+    }
+    std::vector<Vision::Rect> rois;
+    for (int i = 0; i < options.rois; i++) {
+        const int x0 = rng() % (SIZE - 1);
+        const int y0 = rng() % (SIZE - 1);
+        rois.push_back({x0, y0, x0 + 1 + static_cast<int>(rng() % (SIZE - x0)),
+                        y0 + 1 + static_cast<int>(rng() % (SIZE - y0))});
+    }
+    std::vector<Vision::RoiSet> sets((options.rois + Vision::RoiSet::MAX_ROIS - 1) / Vision::RoiSet::MAX_ROIS);
+    for (int i = 0; i < options.rois; i++) {
+        sets[i / Vision::RoiSet::MAX_ROIS].add(rois[i], Vision::CLASS_WHITE, 50);
+    }
+
+    std::vector<int> naive_counts;
+    std::vector<int> mask_counts;
+    const double naive_ns = time_method(samples, rois, options.iterations, naive_counts,
+                                        [](const Sample& sample, const Vision::Rect& box) {
+        int count = 0;
+        for (int y = box.y0; y < box.y1; y++) {
+            const uint8_t* row = &sample.classes[y * SIZE];
+            for (int x = box.x0; x < box.x1; x++) {
+                count += (row[x] & Vision::CLASS_WHITE) != 0;
+            }
+        }
+        return count;
+    });
+    const double mask_ns = time_method(samples, rois, options.iterations, mask_counts,
+                                       [](const Sample& sample, const Vision::Rect& box) {
+        return sample.mask.count(box.x0, box.y0, box.x1, box.y1);
+    });
+
+    std::vector<int> integral_counts;
+    const double integral_ns = time_method(samples, rois, options.iterations, integral_counts,
+                                           [](const Sample& sample, const Vision::Rect& box) {
+        return sample.integrals.white.count(box.x0, box.y0, box.x1, box.y1);
+    });
+    std::vector<int> set_counts;
+    const double set_ns = time_sets(samples, sets, options.rois, options.iterations, set_counts);
+
+    // The per frame cost the table lookups depend on
+    static Vision::Integral table;
+    const Clock::time_point start = Clock::now();
+    for (int i = 0; i < options.iterations; i++) {
+        for (const Sample& sample : samples) {
+            table.build(sample.mask);
+        }
+    }
+    const double build_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count()
+        / (static_cast<double>(options.iterations) * FRAME_COUNT);
+
+    const bool same = naive_counts == mask_counts && naive_counts == integral_counts && naive_counts == set_counts;
+    printf("{\"rois\": %d, \"queries\": %lld, \"naive_ns_per_roi\": %.1f, \"bitmask_ns_per_roi\": %.1f, "
+           "\"integral_ns_per_roi\": %.1f, \"roi_set_ns_per_roi\": %.1f, \"integral_build_ns\": %.1f, "
+           "\"results_match\": %s}\n",
+           options.rois, static_cast<long long>(options.iterations) * FRAME_COUNT * options.rois, naive_ns, mask_ns,
+           integral_ns, set_ns, build_ns, same ? "true" : "false");
+    return same ? 0 : 1;
+}
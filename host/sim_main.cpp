@@ -0,0 +1,102 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <esp_camera.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include "host_camera.hpp"
+#include "sensor_state.hpp"
+
+extern "C" {
+void app_main(void);
+}
+
+namespace {
+    const char* TAG = "HOST_SIM";
+
+    void usage(const char* program)
+    {
+        fprintf(stderr,
+                "Usage: %s --frames DIR [--fps N] [--loop] [--runs N] [--rewind] [--workdir DIR] [--quiet]\n"
+                "\n"
+                "Runs app_main against captures replayed from DIR/IMAGE*.BIN.\n"
+                "  --fps N        Deliver N frames per second; 0 (default) is as fast as they are taken\n"
+                "  --loop         Start the captures over instead of running dry\n"
+                "  --runs N       Run app_main N times, like N boots (default 1)\n"
+                "  --rewind       Replay the captures from the first one on every boot\n"
+                "  --workdir DIR  Directory holding the simulated card (" MOUNT_POINT ") and NVS (" HOST_NVS_DIR ")\n"
+                "  --quiet        Only print warnings and errors\n",
+                program);
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    HostCamera::Config camera;
+    const char* workdir = nullptr;
+    int runs = 1;
+    bool rewind = false;
+
+    for (int i = 1; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--frames") == 0 && has_value) {
+            camera.directory = argv[++i];
+        } else if (strcmp(argv[i], "--fps") == 0 && has_value) {
+            camera.fps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--loop") == 0) {
+            camera.loop = true;
+        } else if (strcmp(argv[i], "--runs") == 0 && has_value) {
+            runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rewind") == 0) {
+            rewind = true;
+        } else if (strcmp(argv[i], "--workdir") == 0 && has_value) {
+            workdir = argv[++i];
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            esp_log_level_set("*", ESP_LOG_WARN);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    // The captures are loaded before changing directory so a relative path works
+    if (HostCamera::configure(camera) != ESP_OK) {
+        return 1;
+    }
+    if (workdir && chdir(workdir) != 0) {
+        ESP_LOGE(TAG, "Cannot change to %s: %s", workdir, strerror(errno));
+        return 1;
+    }
+
+    // A boot with a stored sensor snapshot only needs to confirm the sensor has settled
+    const std::string snapshot = std::string(HOST_NVS_DIR "/") + SensorState::NVS_NAMESPACE + "/" + SensorState::NVS_KEY;
+
+    const int64_t start = esp_timer_get_time();
+    for (int run = 0; run < runs; run++) {
+        if (rewind) {
+            HostCamera::rewind();
+        }
+        struct stat st;
+        const bool warm = stat(snapshot.c_str(), &st) == 0;
+        const uint64_t frames_before = HostCamera::frames_delivered();
+        const int64_t boot_start = esp_timer_get_time();
+
+        app_main();
+        // A reboot would reset the camera driver
+        esp_camera_deinit();
+
+        printf("boot %d: %s, %llu frames in %.3f s\n", run + 1, warm ? "restored sensor state" : "cold",
+               (unsigned long long)(HostCamera::frames_delivered() - frames_before),
+               (esp_timer_get_time() - boot_start) / 1e6);
+    }
+    const int64_t elapsed = esp_timer_get_time() - start;
+
+    printf("%d run(s), %llu frames in %.3f s\n", runs, (unsigned long long)HostCamera::frames_delivered(),
+           elapsed / 1e6);
+    return 0;
+}
@@ -0,0 +1,295 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <strings.h>
+#include <thread>
+#include <vector>
+#include <esp_log.h>
+#include "esp_camera.h"
+#include "host_camera.hpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr size_t FRAME_BYTES = HostCamera::FRAME_SIZE * HostCamera::FRAME_SIZE * 2;
+
+    HostCamera::Config replay;
+
+    // Every capture, loaded up front
+    std::vector<std::vector<uint8_t>> frames;
+
+    std::mutex mutex;
+    std::condition_variable returned;
+
+    // The driver's frame buffers and which of them are handed out
+    std::vector<camera_fb_t> buffers;
+    std::vector<bool> in_use;
+    bool initialized = false;
+
+    size_t next_frame = 0;
+    uint64_t delivered = 0;
+
+    // Frames delivered since esp_camera_init(), and when that was, for pacing
+    uint64_t paced = 0;
+    Clock::time_point replay_start;
+
+    std::map<int, int> registers;
+
+    // Where the frame buffers are, for note_copy(). It has its own lock because
+    // it runs inside memcpy(), which esp_camera_fb_get() calls with mutex held.
+    std::mutex buffers_mutex;
+    std::vector<const uint8_t*> buffer_starts;
+    std::atomic<uint64_t> copies{0};
+    std::atomic<uint64_t> copied_bytes{0};
+
+    int get_reg(sensor_t*, int reg, int mask)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return registers[reg] & mask;
+    }
+
+    int set_reg(sensor_t*, int reg, int mask, int value)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        registers[reg] = (registers[reg] & ~mask) | (value & mask);
+        return 0;
+    }
+
+    int set_res_raw(sensor_t*, int, int, int, int, int, int, int, int, int, int, bool, bool)
+    {
+        // The replayed frames have a fixed size
+        return -1;
+    }
+
+    sensor_t sensor = {{0x7F, 0xA2, OV2640_PID, 0x42}, get_reg, set_reg, set_res_raw};
+
+    // Image number of a capture's file name, or -1 if it is not IMAGE{n}.BIN
+    int image_number(const char* name)
+    {
+        int number;
+        char extension[8];
+        if (strncasecmp(name, "IMAGE", 5) != 0 || sscanf(name + 5, "%d%7s", &number, extension) != 2 ||
+            strcasecmp(extension, ".BIN") != 0) {
+            return -1;
+        }
+        return number;
+    }
+}
+
+
+esp_err_t HostCamera::configure(const Config& config)
+{
+    DIR* dir = opendir(config.directory);
+    if (!dir) {
+        ESP_LOGE(TAG, "Cannot open capture directory %s", config.directory);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    std::vector<std::pair<int, std::string>> files;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        const int number = image_number(entry->d_name);
+        if (number >= 0) {
+            files.emplace_back(number, std::string(config.directory) + "/" + entry->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    frames.clear();
+    for (const auto& file : files) {
+        FILE* in = fopen(file.second.c_str(), "rb");
+        if (!in) {
+            continue;
+        }
+        std::vector<uint8_t> frame(FRAME_BYTES + 1);
+        const size_t length = fread(frame.data(), 1, frame.size(), in);
+        fclose(in);
+        if (length != FRAME_BYTES) {
+            ESP_LOGW(TAG, "Skipping %s: not a 96x96 RGB565 frame", file.second.c_str());
+            continue;
+        }
+        frame.resize(FRAME_BYTES);
+        frames.push_back(std::move(frame));
+    }
+
+    replay = config;
+    next_frame = 0;
+    ESP_LOGI(TAG, "Loaded %u captures from %s", (unsigned)frames.size(), config.directory);
+    return frames.empty() ? ESP_ERR_NOT_FOUND : ESP_OK;
+}
+
+
+size_t HostCamera::frame_count()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return frames.size();
+}
+
+
+uint64_t HostCamera::frames_delivered()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return delivered;
+}
+
+
+void HostCamera::rewind()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    next_frame = 0;
+}
+
+
+HostCamera::CopyStats HostCamera::copy_stats()
+{
+    return {copies.load(std::memory_order_relaxed), copied_bytes.load(std::memory_order_relaxed)};
+}
+
+
+void HostCamera::reset_copy_stats()
+{
+    copies.store(0, std::memory_order_relaxed);
+    copied_bytes.store(0, std::memory_order_relaxed);
+}
+
+
+void HostCamera::note_copy(const void* source, size_t length)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(source);
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    for (const uint8_t* start : buffer_starts) {
+        if (bytes >= start && bytes < start + FRAME_BYTES) {
+            copies.fetch_add(1, std::memory_order_relaxed);
+            copied_bytes.fetch_add(length, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+
+esp_err_t esp_camera_init(const camera_config_t* config)
+{
+    if (config->pixel_format != PIXFORMAT_RGB565 || config->frame_size != FRAMESIZE_96X96) {
+        ESP_LOGE(HostCamera::TAG, "Only 96x96 RGB565 frames can be replayed");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const size_t count = config->fb_count ? config->fb_count : 1;
+    buffers.assign(count, camera_fb_t{});
+    in_use.assign(count, false);
+    for (camera_fb_t& fb : buffers) {
+        fb.buf = new uint8_t[FRAME_BYTES];
+        fb.len = FRAME_BYTES;
+        fb.width = HostCamera::FRAME_SIZE;
+        fb.height = HostCamera::FRAME_SIZE;
+        fb.format = PIXFORMAT_RGB565;
+    }
+    {
+        std::lock_guard<std::mutex> buffers_lock(buffers_mutex);
+        buffer_starts.clear();
+        for (const camera_fb_t& fb : buffers) {
+            buffer_starts.push_back(fb.buf);
+        }
+    }
+    initialized = true;
+    paced = 0;
+    replay_start = Clock::now();
+    return ESP_OK;
+}
+
+
+esp_err_t esp_camera_deinit()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    {
+        std::lock_guard<std::mutex> buffers_lock(buffers_mutex);
+        buffer_starts.clear();
+    }
+    for (camera_fb_t& fb : buffers) {
+        delete[] fb.buf;
+    }
+    buffers.clear();
+    in_use.clear();
+    initialized = false;
+    return ESP_OK;
+}
+
+
+camera_fb_t* esp_camera_fb_get()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!initialized) {
+        return nullptr;
+    }
+    const auto deadline = Clock::now() + std::chrono::milliseconds(HostCamera::FB_GET_TIMEOUT_MS);
+
+    // Pace the replay to the configured frame rate
+    if (replay.fps > 0) {
+        const auto due = replay_start + std::chrono::microseconds(1000000 * paced / replay.fps);
+        lock.unlock();
+        std::this_thread::sleep_until(std::min(due, deadline));
+        lock.lock();
+    }
+
+    // Like the driver, wait for the application to return a buffer
+    size_t index = 0;
+    const auto free_buffer = [&index]() {
+        for (index = 0; index < in_use.size(); index++) {
+            if (!in_use[index]) {
+                return true;
+            }
+        }
+        return false;
+    };
+    const bool have_frame = next_frame < frames.size() || (replay.loop && !frames.empty());
+    if (!have_frame || !returned.wait_until(lock, deadline, free_buffer)) {
+        // An exhausted replay times out like a camera that stopped sending
+        lock.unlock();
+        std::this_thread::sleep_until(deadline);
+        ESP_LOGE(HostCamera::TAG, "Failed to get the frame on time!");
+        return nullptr;
+    }
+
+    if (next_frame >= frames.size()) {
+        next_frame = 0;
+    }
+    camera_fb_t& fb = buffers[index];
+    memcpy(fb.buf, frames[next_frame].data(), FRAME_BYTES);
+    gettimeofday(&fb.timestamp, nullptr);
+    in_use[index] = true;
+    next_frame++;
+    delivered++;
+    paced++;
+    return &fb;
+}
+
+
+void esp_camera_fb_return(camera_fb_t* fb)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < buffers.size(); i++) {
+        if (&buffers[i] == fb) {
+            in_use[i] = false;
+        }
+    }
+    returned.notify_all();
+}
+
+
+sensor_t* esp_camera_sensor_get()
+{
+    return initialized ? &sensor : nullptr;
+}
@@ -0,0 +1,120 @@
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <esp_cpu.h>
+#include <esp_err.h>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+namespace {
+    const auto start_time = std::chrono::steady_clock::now();
+
+    std::atomic<int> log_level{ESP_LOG_INFO};
+
+    std::atomic<uint64_t> allocations{0};
+}
+
+
+const char* esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        default: return "UNKNOWN ERROR";
+    }
+}
+
+
+void esp_error_check_failed(esp_err_t rc, const char* file, int line, const char* expression)
+{
+    fprintf(stderr, "ESP_ERROR_CHECK failed: esp_err_t 0x%x (%s) at %s:%d\nexpression: %s\n",
+            rc, esp_err_to_name(rc), file, line, expression);
+    abort();
+}
+
+
+int64_t esp_timer_get_time()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count()
+{
+    const auto elapsed = std::chrono::steady_clock::now() - start_time;
+    return static_cast<esp_cpu_cycle_count_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+
+uint32_t esp_log_timestamp()
+{
+    return static_cast<uint32_t>(esp_timer_get_time() / 1000);
+}
+
+
+void esp_log_level_set(const char* tag, esp_log_level_t level)
+{
+    (void)tag;
+    log_level.store(level, std::memory_order_relaxed);
+}
+
+
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...)
+{
+    (void)tag;
+    if (level > log_level.load(std::memory_order_relaxed)) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
+
+
+void* heap_caps_malloc(size_t size, uint32_t caps)
+{
+    return heap_caps_aligned_alloc(4, size, caps);
+}
+
+
+void* heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    void* ptr = heap_caps_malloc(n * size, caps);
+    if (ptr) {
+        memset(ptr, 0, n * size);
+    }
+    return ptr;
+}
+
+
+void* heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps)
+{
+    (void)caps;
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    // aligned_alloc needs a size that is a multiple of the alignment
+    return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+
+void heap_caps_free(void* ptr)
+{
+    free(ptr);
+}
+
+
+uint64_t heap_caps_allocation_count()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
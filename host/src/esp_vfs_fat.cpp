@@ -0,0 +1,73 @@
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <esp_log.h>
+#include "esp_vfs_fat.h"
+#include "sdmmc_cmd.h"
+
+namespace {
+    const char* TAG = "HOST_VFS";
+
+    std::string mount_path;
+    sdmmc_card_t card;
+}
+
+
+esp_err_t esp_vfs_fat_sdmmc_mount(const char* base_path, const sdmmc_host_t* host_config,
+                                  const void* slot_config, const esp_vfs_fat_mount_config_t* mount_config,
+                                  sdmmc_card_t** out_card)
+{
+    (void)host_config;
+    (void)slot_config;
+    (void)mount_config;
+
+    if (!mount_path.empty()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (mkdir(base_path, 0777) != 0 && errno != EEXIST) {
+        ESP_LOGE(TAG, "Cannot create %s for the card", base_path);
+        return ESP_FAIL;
+    }
+
+    mount_path = base_path;
+    card.path = mount_path.c_str();
+    if (out_card) {
+        *out_card = &card;
+    }
+    return ESP_OK;
+}
+
+
+esp_err_t esp_vfs_fat_sdmmc_unmount()
+{
+    if (mount_path.empty()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    mount_path.clear();
+    return ESP_OK;
+}
+
+
+esp_err_t esp_vfs_fat_create_contiguous_file(const char* base_path, const char* full_path, uint64_t size,
+                                             bool alloc_now)
+{
+    (void)base_path;
+    (void)alloc_now;
+
+    const int fd = open(full_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        return ESP_FAIL;
+    }
+    const int err = posix_fallocate(fd, 0, static_cast<off_t>(size));
+    close(fd);
+    return err == 0 ? ESP_OK : ESP_FAIL;
+}
+
+
+void sdmmc_card_print_info(FILE* stream, const sdmmc_card_t* card)
+{
+    fprintf(stream, "Name: host directory %s\n", card ? card->path : "(none)");
+}
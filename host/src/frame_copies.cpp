@@ -0,0 +1,12 @@
+#include <cstddef>
+#include "host_camera.hpp"
+
+// Only linked into programs built with -Wl,--wrap=memcpy, which then count
+// every copy the firmware makes out of a camera frame buffer
+extern "C" void* __real_memcpy(void* destination, const void* source, size_t length);
+
+extern "C" void* __wrap_memcpy(void* destination, const void* source, size_t length)
+{
+    HostCamera::note_copy(source, length);
+    return __real_memcpy(destination, source, length);
+}
@@ -0,0 +1,158 @@
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+// A fixed ring of items like the FreeRTOS queue, so sending does not allocate
+struct QueueDefinition {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<uint8_t> storage;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head = 0;   ///< Slot of the oldest item
+    UBaseType_t count = 0;  ///< Items waiting
+};
+
+namespace {
+    // Thrown by vTaskDelete(nullptr) to unwind the task back to its thread
+    struct TaskExit {};
+
+    struct TaskStart {
+        TaskFunction_t function;
+        void* parameters;
+        BaseType_t core;
+    };
+
+    thread_local BaseType_t current_core = 0;
+
+    const auto start_time = std::chrono::steady_clock::now();
+
+    // Wait on a queue until ready() holds, for at most ticks
+    template <typename Ready>
+    bool wait(QueueDefinition* queue, std::unique_lock<std::mutex>& lock, TickType_t ticks, Ready ready)
+    {
+        if (ticks == portMAX_DELAY) {
+            queue->changed.wait(lock, ready);
+            return true;
+        }
+        return queue->changed.wait_for(lock, std::chrono::milliseconds(ticks * portTICK_PERIOD_MS), ready);
+    }
+}
+
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_depth,
+                                   void* parameters, UBaseType_t priority, TaskHandle_t* created_task,
+                                   BaseType_t core_id)
+{
+    (void)name;
+    (void)stack_depth;
+    (void)priority;
+
+    const TaskStart start = {function, parameters, core_id == tskNO_AFFINITY ? 0 : core_id};
+    std::thread thread([start]() {
+        current_core = start.core;
+        try {
+            start.function(start.parameters);
+        } catch (const TaskExit&) {
+        }
+    });
+    if (created_task) {
+        *created_task = reinterpret_cast<TaskHandle_t>(static_cast<uintptr_t>(thread.native_handle()));
+    }
+    // Tasks are never joined, they end by deleting themselves
+    thread.detach();
+    return pdPASS;
+}
+
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == nullptr) {
+        throw TaskExit{};
+    }
+    // Threads cannot be stopped from outside; the firmware only deletes the calling task
+}
+
+
+void vTaskDelay(TickType_t ticks)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks * portTICK_PERIOD_MS));
+}
+
+
+TickType_t xTaskGetTickCount()
+{
+    const auto elapsed = std::chrono::steady_clock::now() - start_time;
+    return static_cast<TickType_t>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() /
+                                   portTICK_PERIOD_MS);
+}
+
+
+BaseType_t xPortGetCoreID()
+{
+    return current_core;
+}
+
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    if (length == 0) {
+        return nullptr;
+    }
+    QueueDefinition* queue = new QueueDefinition;
+    queue->length = length;
+    queue->item_size = item_size;
+    queue->storage.resize(static_cast<size_t>(length) * item_size);
+    return queue;
+}
+
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    delete queue;
+}
+
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks_to_wait)
+{
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!wait(queue, lock, ticks_to_wait, [queue] { return queue->count < queue->length; })) {
+        return pdFALSE;
+    }
+    const UBaseType_t tail = (queue->head + queue->count) % queue->length;
+    if (item && queue->item_size) {
+        memcpy(queue->storage.data() + static_cast<size_t>(tail) * queue->item_size, item, queue->item_size);
+    }
+    queue->count++;
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* buffer, TickType_t ticks_to_wait)
+{
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!wait(queue, lock, ticks_to_wait, [queue] { return queue->count > 0; })) {
+        return pdFALSE;
+    }
+    if (buffer && queue->item_size) {
+        memcpy(buffer, queue->storage.data() + static_cast<size_t>(queue->head) * queue->item_size, queue->item_size);
+    }
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    return queue->count;
+}
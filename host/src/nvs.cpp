@@ -0,0 +1,175 @@
+#include <cerrno>
+#include <cstdio>
+#include <dirent.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "nvs_flash.h"
+
+namespace {
+    struct Handle {
+        std::string directory;
+        bool writable;
+    };
+
+    bool initialized = false;
+
+    // Index + 1 is the handle given out, 0 is never valid
+    std::vector<Handle> handles;
+
+    Handle* lookup(nvs_handle_t handle)
+    {
+        if (handle == 0 || handle > handles.size() || handles[handle - 1].directory.empty()) {
+            return nullptr;
+        }
+        return &handles[handle - 1];
+    }
+
+    std::string key_path(const Handle& handle, const char* key)
+    {
+        return handle.directory + "/" + key;
+    }
+}
+
+
+esp_err_t nvs_flash_init()
+{
+    if (mkdir(HOST_NVS_DIR, 0777) != 0 && errno != EEXIST) {
+        return ESP_FAIL;
+    }
+    initialized = true;
+    return ESP_OK;
+}
+
+
+esp_err_t nvs_flash_erase()
+{
+    DIR* root = opendir(HOST_NVS_DIR);
+    if (!root) {
+        return ESP_OK;
+    }
+    struct dirent* space;
+    while ((space = readdir(root)) != nullptr) {
+        if (space->d_name[0] == '.') {
+            continue;
+        }
+        const std::string directory = std::string(HOST_NVS_DIR "/") + space->d_name;
+        DIR* keys = opendir(directory.c_str());
+        struct dirent* key;
+        while (keys && (key = readdir(keys)) != nullptr) {
+            if (key->d_name[0] != '.') {
+                unlink((directory + "/" + key->d_name).c_str());
+            }
+        }
+        if (keys) {
+            closedir(keys);
+        }
+        rmdir(directory.c_str());
+    }
+    closedir(root);
+    return ESP_OK;
+}
+
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t open_mode, nvs_handle_t* out_handle)
+{
+    if (!initialized) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    const std::string directory = std::string(HOST_NVS_DIR "/") + name;
+    struct stat st;
+    if (stat(directory.c_str(), &st) != 0) {
+        // As on the device, a read-only open of a namespace that was never written fails
+        if (open_mode == NVS_READONLY) {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        if (mkdir(directory.c_str(), 0777) != 0) {
+            return ESP_FAIL;
+        }
+    }
+
+    handles.push_back({directory, open_mode == NVS_READWRITE});
+    *out_handle = static_cast<nvs_handle_t>(handles.size());
+    return ESP_OK;
+}
+
+
+void nvs_close(nvs_handle_t handle)
+{
+    if (Handle* h = lookup(handle)) {
+        h->directory.clear();
+    }
+}
+
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    // Values are written through on set
+    return lookup(handle) ? ESP_OK : ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t length)
+{
+    Handle* h = lookup(handle);
+    if (!h) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (!h->writable) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+
+    FILE* file = fopen(key_path(*h, key).c_str(), "wb");
+    if (!file) {
+        return ESP_FAIL;
+    }
+    const bool written = fwrite(value, 1, length, file) == length;
+    return (fclose(file) == 0 && written) ? ESP_OK : ESP_FAIL;
+}
+
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value, size_t* length)
+{
+    Handle* h = lookup(handle);
+    if (!h) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+
+    FILE* file = fopen(key_path(*h, key).c_str(), "rb");
+    if (!file) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    fseek(file, 0, SEEK_END);
+    const size_t size = static_cast<size_t>(ftell(file));
+    fseek(file, 0, SEEK_SET);
+
+    // A null buffer asks for the stored length only
+    esp_err_t err = ESP_OK;
+    if (out_value) {
+        if (*length < size) {
+            err = ESP_ERR_NVS_INVALID_LENGTH;
+        } else if (fread(out_value, 1, size, file) != size) {
+            err = ESP_FAIL;
+        }
+    }
+    if (err == ESP_OK) {
+        *length = size;
+    }
+    fclose(file);
+    return err;
+}
+
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key)
+{
+    Handle* h = lookup(handle);
+    if (!h) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (!h->writable) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    return unlink(key_path(*h, key).c_str()) == 0 ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
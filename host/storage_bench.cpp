@@ -0,0 +1,393 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <esp_camera.h>
+#include <esp_log.h>
+#include "aligned_writer.hpp"
+#include "constants.hpp"
+#include "container.hpp"
+#include "sdcard.hpp"
+#include "write_behind.hpp"
+
+/*
+ * Times the ways the firmware writes to the SD card against the code they
+ * replaced, on the directory standing in for the card, and prints one JSON
+ * line per benchmark. The host filesystem is far faster than FAT on an SD
+ * card, so compare the ratios rather than the absolute times.
+ */
+
+namespace {
+    const char* TAG = "STORAGE_BENCH";
+
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int FRAME_SIZE = 96;
+    constexpr size_t FRAME_BYTES = FRAME_SIZE * FRAME_SIZE * 2;
+
+    struct Options {
+        const char* workdir = nullptr;
+        int images = 1000;
+        int fps = 30;
+        int card_kbps = 1024;
+        int seconds = 5;
+    };
+
+    // Bandwidth write() is throttled to while set, in bytes per second
+    std::atomic<uint32_t> card_bytes_per_second{0};
+
+    // The writes that reached the card, as a block device with SD_SECTOR_SIZE sectors sees them
+    struct CardCounters {
+        std::atomic<uint32_t> writes{0};
+        std::atomic<uint32_t> partial_writes{0};    ///< Writes starting or ending mid-sector
+        std::atomic<uint64_t> device_bytes{0};      ///< Sectors written, plus partial sectors read back first
+    };
+    CardCounters card;
+
+    void usage(const char* program)
+    {
+        fprintf(stderr,
+                "Usage: %s [--images N] [--fps N] [--card-kbps N] [--seconds N] [--workdir DIR]\n"
+                "\n"
+                "  --images N     Images to name or write in each benchmark (default 1000)\n"
+                "  --fps N        Frame rate of the write-behind benchmark (default 30)\n"
+                "  --card-kbps N  Card write speed, for the modelled card time and the write-behind throttle\n"
+                "                 (default 1024)\n"
+                "  --seconds N    Length of each write-behind run (default 5)\n"
+                "  --workdir DIR  Directory to create the simulated card (" MOUNT_POINT ") in,\n"
+                "                 a new directory under /tmp by default\n",
+                program);
+    }
+
+    // Bytes a block device moves for one write: every sector it touches is
+    // written, and a sector only partly covered has to be read first
+    uint64_t device_cost(uint64_t offset, size_t length)
+    {
+        const uint64_t first = offset / SD_SECTOR_SIZE;
+        const uint64_t end = (offset + length + SD_SECTOR_SIZE - 1) / SD_SECTOR_SIZE;
+        const bool partial_head = offset % SD_SECTOR_SIZE != 0;
+        const bool partial_tail = (offset + length) % SD_SECTOR_SIZE != 0;
+        uint64_t reads = partial_head ? 1 : 0;
+        if (partial_tail && !(partial_head && end - 1 == first)) {
+            reads++;
+        }
+        return (end - first + reads) * SD_SECTOR_SIZE;
+    }
+
+    void reset_card()
+    {
+        card.writes = 0;
+        card.partial_writes = 0;
+        card.device_bytes = 0;
+    }
+
+    double ns_per(Clock::time_point start, int count)
+    {
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / count;
+    }
+
+    // Remove everything a previous benchmark left on the card
+    void clear_card()
+    {
+        for (const auto& entry : std::filesystem::directory_iterator(MOUNT_POINT)) {
+            std::filesystem::remove_all(entry.path());
+        }
+    }
+
+    // get_next_filename as it was before the counter was kept in RAM: read
+    // and rewrite CONFIG_FILE for every image
+    void config_file_next_filename(char* filename)
+    {
+        int file_number = 0;
+        FILE* config_file = fopen(CONFIG_FILE, "r");
+        if (config_file) {
+            if (fscanf(config_file, "%d", &file_number) != 1) {
+                file_number = 0;
+            }
+            fclose(config_file);
+        }
+
+        sprintf(filename, MOUNT_POINT "/" FILE_PREFIX "%d" FILE_EXTENSION, file_number);
+
+        config_file = fopen(CONFIG_FILE, "w");
+        if (config_file) {
+            fprintf(config_file, "%d", file_number + 1);
+            fclose(config_file);
+        }
+    }
+
+    // Cost of handing out a file name, with the counter in config.txt against in RAM
+    void bench_counter(const Options& options)
+    {
+        char filename[32];
+
+        clear_card();
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < options.images; i++) {
+            config_file_next_filename(filename);
+        }
+        const double config_file_ns = ns_per(start, options.images);
+
+        clear_card();
+        SDCard::load_image_counter();
+        start = Clock::now();
+        for (int i = 0; i < options.images; i++) {
+            SDCard::get_next_filename(filename);
+        }
+        SDCard::flush_image_counter();
+        const double ram_counter_ns = ns_per(start, options.images);
+
+        printf("{\"bench\": \"counter\", \"images\": %d, \"config_file_ns\": %.0f, \"ram_counter_ns\": %.0f}\n",
+               options.images, config_file_ns, ram_counter_ns);
+    }
+
+    // A frame with some variation, so no layer can skip writing it
+    std::vector<uint8_t> make_frame()
+    {
+        std::vector<uint8_t> frame(FRAME_BYTES);
+        for (size_t i = 0; i < frame.size(); i++) {
+            frame[i] = static_cast<uint8_t>(i * 7 + (i >> 8));
+        }
+        return frame;
+    }
+
+    // Write time per frame into a container, with and without preallocation
+    double container_ns(const Options& options, const std::vector<uint8_t>& frame, size_t preallocate)
+    {
+        clear_card();
+        Container::Writer writer;
+        const Clock::time_point start = Clock::now();
+        if (writer.open(MOUNT_POINT "/FRAMES.CFC", preallocate) != ESP_OK) {
+            return 0;
+        }
+        for (int i = 0; i < options.images; i++) {
+            writer.append(frame.data(), frame.size(), FRAME_SIZE, FRAME_SIZE, PIXFORMAT_RGB565, i);
+        }
+        writer.close();
+        return ns_per(start, options.images);
+    }
+
+    // One IMAGE{n}.BIN per frame, as capture_and_save_image_nocv writes them, against a container
+    void bench_container(const Options& options)
+    {
+        const std::vector<uint8_t> frame = make_frame();
+        char filename[32];
+
+        clear_card();
+        SDCard::load_image_counter();
+        const Clock::time_point start = Clock::now();
+        for (int i = 0; i < options.images; i++) {
+            SDCard::get_next_filename(filename);
+            FILE* file = fopen(filename, "wb");
+            if (!file) {
+                ESP_LOGE(TAG, "Failed to open %s", filename);
+                return;
+            }
+            fwrite(frame.data(), 1, frame.size(), file);
+            fclose(file);
+        }
+        SDCard::flush_image_counter();
+        const double per_file_ns = ns_per(start, options.images);
+
+        const size_t frame_record = sizeof(Container::FrameHeader) + FRAME_BYTES;
+        const size_t preallocate = SD_SECTOR_SIZE + options.images * frame_record + SD_ALLOCATION_UNIT;
+        printf("{\"bench\": \"container\", \"images\": %d, \"per_file_ns\": %.0f, \"container_ns\": %.0f, "
+               "\"preallocated_ns\": %.0f}\n",
+               options.images, per_file_ns, container_ns(options, frame, 0),
+               container_ns(options, frame, preallocate));
+    }
+
+    // Print what a run cost the card, for the frame bytes it was asked to store
+    void print_card_run(const char* name, uint64_t payload_bytes, const Options& options)
+    {
+        const uint64_t device_bytes = card.device_bytes.load();
+        printf("\"%s\": {\"writes\": %lu, \"partial_writes\": %lu, \"amplification\": %.2f, \"card_ms\": %.0f}",
+               name, (unsigned long)card.writes.load(), (unsigned long)card.partial_writes.load(),
+               static_cast<double>(device_bytes) / payload_bytes,
+               device_bytes * 1000.0 / (options.card_kbps * 1024.0));
+    }
+
+    // The same frame records written straight to the file, as the container
+    // did before AlignedWriter, and through AlignedWriter packed and padded
+    void bench_aligned(const Options& options)
+    {
+        const std::vector<uint8_t> frame = make_frame();
+        const Container::FrameHeader header = {};
+        const uint64_t payload_bytes = uint64_t{sizeof(header) + FRAME_BYTES} * options.images;
+        const char* path = MOUNT_POINT "/FRAMES.CFC";
+
+        printf("{\"bench\": \"aligned\", \"images\": %d, ", options.images);
+
+        clear_card();
+        const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            ESP_LOGE(TAG, "Failed to open %s", path);
+            return;
+        }
+        reset_card();
+        for (int i = 0; i < options.images; i++) {
+            if (write(fd, &header, sizeof(header)) != sizeof(header)
+                || write(fd, frame.data(), frame.size()) != static_cast<ssize_t>(frame.size())) {
+                ESP_LOGE(TAG, "Failed to write %s", path);
+                break;
+            }
+        }
+        close(fd);
+        print_card_run("unaligned", payload_bytes, options);
+
+        for (const bool padded : {false, true}) {
+            clear_card();
+            AlignedWriter writer;
+            writer.open(path);
+            reset_card();
+            for (int i = 0; i < options.images; i++) {
+                writer.write(&header, sizeof(header));
+                writer.write(frame.data(), frame.size());
+                if (padded) {
+                    writer.pad_to_sector();
+                }
+            }
+            writer.close();
+            printf(", ");
+            print_card_run(padded ? "padded" : "aligned", payload_bytes, options);
+        }
+        printf("}\n");
+    }
+
+    struct Latency {
+        double mean_us;
+        double max_us;
+    };
+
+    // Feed frames at the camera's rate and time how long the capture side is held up by each
+    template <typename Store>
+    Latency paced_run(const Options& options, const std::vector<uint8_t>& frame, Store store)
+    {
+        const int frames = options.fps * options.seconds;
+        const Clock::duration period = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / options.fps));
+        double total_us = 0;
+        double max_us = 0;
+
+        const Clock::time_point first = Clock::now();
+        for (int i = 0; i < frames; i++) {
+            std::this_thread::sleep_until(first + i * period);
+            const Clock::time_point start = Clock::now();
+            store(frame, i);
+            const double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+            total_us += us;
+            max_us = std::max(max_us, us);
+        }
+        return {total_us / frames, max_us};
+    }
+
+    // Capture-side cost of appending to a container directly against queueing for the writer task
+    void bench_write_behind(const Options& options)
+    {
+        const std::vector<uint8_t> frame = make_frame();
+        Container::Writer writer;
+        card_bytes_per_second = static_cast<uint32_t>(options.card_kbps) * 1024;
+
+        clear_card();
+        writer.open(MOUNT_POINT "/FRAMES.CFC");
+        const Latency direct = paced_run(options, frame, [&](const std::vector<uint8_t>& data, int i) {
+            writer.append(data.data(), data.size(), FRAME_SIZE, FRAME_SIZE, PIXFORMAT_RGB565, i);
+        });
+        writer.close();
+
+        clear_card();
+        writer.open(MOUNT_POINT "/FRAMES.CFC");
+        if (WriteBehind::start(writer) != ESP_OK) {
+            card_bytes_per_second = 0;
+            return;
+        }
+        const Latency queued = paced_run(options, frame, [](const std::vector<uint8_t>& data, int i) {
+            WriteBehind::submit(data.data(), data.size(), FRAME_SIZE, FRAME_SIZE, PIXFORMAT_RGB565, i);
+        });
+        WriteBehind::stop();
+        writer.close();
+        card_bytes_per_second = 0;
+
+        const WriteBehind::Stats stats = WriteBehind::get_stats();
+        printf("{\"bench\": \"write_behind\", \"fps\": %d, \"card_kbps\": %d, \"frames\": %d, "
+               "\"direct_mean_us\": %.1f, \"direct_max_us\": %.1f, \"queued_mean_us\": %.1f, "
+               "\"queued_max_us\": %.1f, \"stall_us\": %llu, \"dropped\": %lu, \"max_queue_depth\": %lu}\n",
+               options.fps, options.card_kbps, options.fps * options.seconds, direct.mean_us, direct.max_us,
+               queued.mean_us, queued.max_us, (unsigned long long)stats.stall_time_us,
+               (unsigned long)stats.dropped, (unsigned long)stats.max_queue_depth);
+    }
+}
+
+
+// The build wraps write() here, so the firmware's direct writes to the card
+// are counted and can be slowed to the speed of a real one
+extern "C" ssize_t __real_write(int fd, const void* data, size_t length);
+
+extern "C" ssize_t __wrap_write(int fd, const void* data, size_t length)
+{
+    const off_t offset = fd > STDERR_FILENO ? lseek(fd, 0, SEEK_CUR) : -1;
+    if (offset >= 0 && length > 0) {
+        const uint64_t cost = device_cost(offset, length);
+        card.writes.fetch_add(1, std::memory_order_relaxed);
+        if ((offset | length) % SD_SECTOR_SIZE != 0) {
+            card.partial_writes.fetch_add(1, std::memory_order_relaxed);
+        }
+        card.device_bytes.fetch_add(cost, std::memory_order_relaxed);
+
+        const uint32_t rate = card_bytes_per_second.load(std::memory_order_relaxed);
+        if (rate) {
+            std::this_thread::sleep_for(std::chrono::microseconds(cost * 1000000 / rate));
+        }
+    }
+    return __real_write(fd, data, length);
+}
+
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--images") == 0 && has_value) {
+            options.images = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--fps") == 0 && has_value) {
+            options.fps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--card-kbps") == 0 && has_value) {
+            options.card_kbps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seconds") == 0 && has_value) {
+            options.seconds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--workdir") == 0 && has_value) {
+            options.workdir = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.images <= 0 || options.fps <= 0 || options.card_kbps <= 0 || options.seconds <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    char temp_dir[] = "/tmp/storage_benchXXXXXX";
+    const char* workdir = options.workdir ? options.workdir : mkdtemp(temp_dir);
+    if (!workdir || chdir(workdir) != 0) {
+        ESP_LOGE(TAG, "Cannot use %s as the working directory", workdir ? workdir : temp_dir);
+        return 1;
+    }
+    // The card does not need mounting on the host, only its directory
+    std::filesystem::create_directories(MOUNT_POINT);
+
+    bench_counter(options);
+    bench_container(options);
+    bench_aligned(options);
+    bench_write_behind(options);
+    return 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+/**
+ * @brief The few helpers the host tests share
+ *
+ * A test is a plain executable: CHECK() reports every failed condition and
+ * Test::result() turns the failure count into the exit status ctest reads.
+ */
+namespace Test {
+
+    /// @brief Conditions that failed so far
+    inline int failures = 0;
+
+    inline bool check(bool ok, const char* expression, const char* file, int line) {
+        if (!ok) {
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expression);
+            failures++;
+        }
+        return ok;
+    }
+
+    /// @brief Exit status for main(): 0 if every check passed
+    inline int result() {
+        if (failures) {
+            fprintf(stderr, "%d check(s) failed\n", failures);
+        }
+        return failures ? 1 : 0;
+    }
+
+    /// @brief Create an empty scratch directory under /tmp
+    inline std::string temp_dir(const char* name) {
+        std::string path = std::string("/tmp/") + name + "_XXXXXX";
+        if (!mkdtemp(path.data())) {
+            perror("mkdtemp");
+            exit(1);
+        }
+        return path;
+    }
+}
+
+/// @brief Report a failed condition and carry on; evaluates to the condition
+#define CHECK(expression) Test::check((expression), #expression, __FILE__, __LINE__)
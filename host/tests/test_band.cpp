@@ -0,0 +1,136 @@
+#include <random>
+#include <vector>
+#include "class_lut.hpp"
+#include "test.hpp"
+#include "vision.hpp"
+
+/*
+ * Checks that the detectors give the same results on a frame cropped to the
+ * rows from FIRST_USED_ROW down, as the camera captures it, as on the whole
+ * frame.
+ */
+
+namespace {
+    constexpr int SIZE = 96;
+    constexpr int FRAME_COUNT = 300;
+
+    // Random noise with a few solid rectangles of random colours on top
+    void random_frame(std::mt19937& rng, std::vector<uint8_t>& frame)
+    {
+        for (uint8_t& byte : frame) {
+            byte = static_cast<uint8_t>(rng());
+        }
+        for (int i = 0; i < 3; i++) {
+            const int x0 = rng() % (SIZE - 6);
+            const int y0 = rng() % (SIZE - 6);
+            const int x1 = x0 + rng() % 30;
+            const int y1 = y0 + rng() % 30;
+            const uint16_t code = static_cast<uint16_t>(rng());
+            for (int y = y0; y < y1 && y < SIZE; y++) {
+                for (int x = x0; x < x1 && x < SIZE; x++) {
+                    frame[2 * (y * SIZE + x)] = static_cast<uint8_t>(code >> 8);
+                    frame[2 * (y * SIZE + x) + 1] = static_cast<uint8_t>(code);
+                }
+            }
+        }
+    }
+
+    bool same_box(const Vision::BoxResult& a, const Vision::BoxResult& b)
+    {
+        return a.count == b.count && a.total == b.total && a.percent == b.percent && a.triggered == b.triggered;
+    }
+
+    bool same_line(const Vision::SteeringResult& a, const Vision::SteeringResult& b)
+    {
+        return a.found == b.found && a.area == b.area
+            && a.centroid.x == b.centroid.x && a.centroid.y == b.centroid.y
+            && a.top_left.x == b.top_left.x && a.top_left.y == b.top_left.y
+            && a.bottom_left.x == b.bottom_left.x && a.bottom_left.y == b.bottom_left.y
+            && a.steering == b.steering;
+    }
+
+    // Class bits and masks of the rows the band holds
+    bool same_segmentation(const Vision::Segmentation& a, const Vision::Segmentation& b)
+    {
+        bool same = a.stop_red == b.stop_red && a.car_green == b.car_green && a.white == b.white;
+        for (int y = Vision::FIRST_USED_ROW; y < SIZE; y++) {
+            for (int x = 0; x < SIZE; x++) {
+                same = same && a.at(x, y) == b.at(x, y)
+                    && a.red_mask.get(x, y) == b.red_mask.get(x, y)
+                    && a.white_mask.get(x, y) == b.white_mask.get(x, y)
+                    && a.green_mask.get(x, y) == b.green_mask.get(x, y);
+            }
+        }
+        return same;
+    }
+
+    bool same_integrals(const Vision::Integrals& a, const Vision::Integrals& b)
+    {
+        const Vision::Rect regions[] = {Vision::STOPBOX, Vision::CARBOX,
+                                        {0, Vision::WHITE_CROP_ROW + 1, SIZE, SIZE},
+                                        {0, Vision::FIRST_USED_ROW, SIZE, SIZE}};
+        bool same = true;
+        for (const Vision::Rect& r : regions) {
+            same = same && a.red.count(r.x0, r.y0, r.x1, r.y1) == b.red.count(r.x0, r.y0, r.x1, r.y1)
+                && a.white.count(r.x0, r.y0, r.x1, r.y1) == b.white.count(r.x0, r.y0, r.x1, r.y1)
+                && a.green.count(r.x0, r.y0, r.x1, r.y1) == b.green.count(r.x0, r.y0, r.x1, r.y1);
+        }
+        return same;
+    }
+}
+
+
+int main()
+{
+    static Vision::Segmentation full_segmentation;
+    static Vision::Segmentation band_segmentation;
+    static Vision::Integrals full_integrals;
+    static Vision::Integrals band_integrals;
+    static Vision::WhiteLineDetector full_detector;
+    static Vision::WhiteLineDetector band_detector;
+    static Vision::WhiteLineDetector full_tracker;
+    static Vision::WhiteLineDetector band_tracker;
+    full_tracker.set_tracking(true);
+    band_tracker.set_tracking(true);
+    const uint8_t* lut = ClassLut::table();
+
+    std::mt19937 rng(19);
+    std::vector<uint8_t> pixels(2 * SIZE * SIZE);
+    int box_mismatches = 0;
+    int line_mismatches = 0;
+    int segment_mismatches = 0;
+    for (int i = 0; i < FRAME_COUNT; i++) {
+        random_frame(rng, pixels);
+        const Vision::Frame full{pixels.data(), SIZE, SIZE};
+        const Vision::Frame band{pixels.data() + 2 * SIZE * Vision::FIRST_USED_ROW, SIZE, SIZE,
+                                 Vision::FIRST_USED_ROW};
+
+        for (bool early_exit : {false, true}) {
+            box_mismatches += !same_box(Vision::detect_stop_box(full, early_exit),
+                                        Vision::detect_stop_box(band, early_exit));
+            box_mismatches += !same_box(Vision::detect_car_box(full, early_exit),
+                                        Vision::detect_car_box(band, early_exit));
+        }
+
+        const Vision::SteeringResult line = full_detector.detect(full);
+        line_mismatches += !same_line(line, band_detector.detect(band));
+        line_mismatches += !same_line(full_tracker.detect(full), band_tracker.detect(band));
+
+        for (const uint8_t* table : {static_cast<const uint8_t*>(nullptr), lut}) {
+            Vision::segment(full, full_segmentation, table, &full_integrals);
+            Vision::segment(band, band_segmentation, table, &band_integrals);
+            segment_mismatches += !same_segmentation(full_segmentation, band_segmentation);
+            segment_mismatches += !same_integrals(full_integrals, band_integrals);
+            line_mismatches += !same_line(line, band_detector.detect(band_segmentation));
+        }
+    }
+    CHECK(box_mismatches == 0);
+    CHECK(line_mismatches == 0);
+    CHECK(segment_mismatches == 0);
+
+    // The band is all that is read
+    CHECK(band_segmentation.bytes_read == 2u * SIZE * (SIZE - Vision::FIRST_USED_ROW));
+    CHECK(band_segmentation.bytes_read < full_segmentation.bytes_read);
+
+    return Test::result();
+}
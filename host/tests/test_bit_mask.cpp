@@ -0,0 +1,148 @@
+#include <random>
+#include <vector>
+#include "bit_mask.hpp"
+#include "test.hpp"
+
+/*
+ * Checks BitMask against a plain array of bools on random masks, including
+ * boxes that start and end inside a word and a width that leaves padding.
+ */
+
+namespace {
+    template <int W, int H>
+    struct Reference {
+        std::vector<bool> pixels = std::vector<bool>(W * H);
+
+        bool get(int x, int y) const { return pixels[y * W + x]; }
+
+        int count(int x0, int y0, int x1, int y1) const {
+            int total = 0;
+            for (int y = y0 < 0 ? 0 : y0; y < y1 && y < H; y++) {
+                for (int x = x0 < 0 ? 0 : x0; x < x1 && x < W; x++) {
+                    total += get(x, y);
+                }
+            }
+            return total;
+        }
+    };
+
+    template <int W, int H>
+    void random_mask(std::mt19937& rng, BitMask<W, H>& mask, Reference<W, H>& reference)
+    {
+        const uint32_t density = rng() % 101;
+        mask.clear();
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                const bool set = rng() % 100 < density;
+                reference.pixels[y * W + x] = set;
+                if (set) {
+                    mask.set(x, y);
+                }
+            }
+        }
+    }
+
+    template <int W, int H>
+    bool same(const BitMask<W, H>& mask, const Reference<W, H>& reference)
+    {
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                if (mask.get(x, y) != reference.get(x, y)) {
+                    return false;
+                }
+            }
+        }
+        return mask.count() == reference.count(0, 0, W, H);
+    }
+
+    template <int W, int H>
+    void check_masks(int seed)
+    {
+        using Mask = BitMask<W, H>;
+        static Mask a;
+        static Mask b;
+        Reference<W, H> ref_a;
+        Reference<W, H> ref_b;
+        std::mt19937 rng(seed);
+
+        int mismatches = 0;
+        for (int i = 0; i < 200; i++) {
+            random_mask(rng, a, ref_a);
+            random_mask(rng, b, ref_b);
+            mismatches += !same(a, ref_a);
+
+            // Boxes with every alignment, some reaching past the edges or empty
+            for (int j = 0; j < 50; j++) {
+                const int x0 = static_cast<int>(rng() % (W + 10)) - 5;
+                const int y0 = static_cast<int>(rng() % (H + 10)) - 5;
+                const int x1 = x0 + static_cast<int>(rng() % (W + 5));
+                const int y1 = y0 + static_cast<int>(rng() % (H + 5));
+                mismatches += a.count(x0, y0, x1, y1) != ref_a.count(x0, y0, x1, y1);
+            }
+
+            // Every single-word and word-straddling column range of one row
+            const int y = rng() % H;
+            for (int x0 = 0; x0 < W; x0++) {
+                for (int x1 = x0; x1 <= W; x1++) {
+                    mismatches += a.count(x0, y, x1, y + 1) != ref_a.count(x0, y, x1, y + 1);
+                }
+            }
+
+            // Projections and the order of for_each_set
+            uint16_t rows[H];
+            uint16_t columns[W];
+            a.row_projection(rows);
+            a.column_projection(columns);
+            for (int r = 0; r < H; r++) {
+                mismatches += rows[r] != ref_a.count(0, r, W, r + 1);
+            }
+            for (int c = 0; c < W; c++) {
+                mismatches += columns[c] != ref_a.count(c, 0, c + 1, H);
+            }
+            int visited = 0;
+            int previous = -1;
+            a.for_each_set([&](int x, int y) {
+                mismatches += !ref_a.get(x, y) || y * W + x <= previous;
+                previous = y * W + x;
+                visited++;
+            });
+            mismatches += visited != ref_a.count(0, 0, W, H);
+
+            // Combining and inverting, which must leave the padding bits clear
+            Mask both = a;
+            both &= b;
+            Mask either = a;
+            either |= b;
+            Mask inverted = a;
+            inverted.invert();
+            Reference<W, H> ref_both;
+            Reference<W, H> ref_either;
+            Reference<W, H> ref_inverted;
+            for (int p = 0; p < W * H; p++) {
+                ref_both.pixels[p] = ref_a.pixels[p] && ref_b.pixels[p];
+                ref_either.pixels[p] = ref_a.pixels[p] || ref_b.pixels[p];
+                ref_inverted.pixels[p] = !ref_a.pixels[p];
+            }
+            mismatches += !same(both, ref_both) + !same(either, ref_either) + !same(inverted, ref_inverted);
+
+            // set and reset of single pixels
+            const int x = rng() % W;
+            a.reset(x, y);
+            ref_a.pixels[y * W + x] = false;
+            mismatches += !same(a, ref_a);
+            a.set(x, y);
+            ref_a.pixels[y * W + x] = true;
+            mismatches += !same(a, ref_a);
+        }
+        CHECK(mismatches == 0);
+    }
+}
+
+
+int main()
+{
+    check_masks<96, 96>(14);
+    check_masks<70, 33>(15);
+    check_masks<32, 5>(16);
+    return Test::result();
+}
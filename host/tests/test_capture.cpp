@@ -0,0 +1,94 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <esp_camera.h>
+#include <esp_log.h>
+#include "camera.hpp"
+#include "capture.hpp"
+#include "host_camera.hpp"
+#include "test.hpp"
+
+/*
+ * Runs the capture task against the replayed camera and checks that a slow
+ * consumer is always handed the newest frame, never a queued older one.
+ */
+
+namespace {
+    constexpr int FRAME_COUNT = 200;
+    constexpr int FPS = 200;
+
+    // Each capture holds its own number in the first pixel
+    void write_frames(const std::string& dir)
+    {
+        std::string pixels(HostCamera::FRAME_SIZE * HostCamera::FRAME_SIZE * 2, '\0');
+        for (int i = 0; i < FRAME_COUNT; i++) {
+            pixels[0] = static_cast<char>(i >> 8);
+            pixels[1] = static_cast<char>(i);
+            const std::string path = dir + "/IMAGE" + std::to_string(i) + ".BIN";
+            FILE* out = fopen(path.c_str(), "wb");
+            fwrite(pixels.data(), 1, pixels.size(), out);
+            fclose(out);
+        }
+    }
+
+    int frame_number(const Camera::FrameHandle& frame)
+    {
+        return (frame.data()[0] << 8) | frame.data()[1];
+    }
+}
+
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_WARN);
+    const std::string dir = Test::temp_dir("test_capture");
+    write_frames(dir);
+
+    HostCamera::Config replay;
+    replay.directory = dir.c_str();
+    replay.fps = FPS;
+    CHECK(HostCamera::configure(replay) == ESP_OK);
+    Camera::config_cam(Capture::FB_COUNT);
+    CHECK(Capture::start(0, 5) == ESP_OK);
+
+    int previous = -1;
+    int taken = 0;
+    for (int i = 0; i < 8; i++) {
+        Camera::FrameHandle frame;
+        CHECK(Capture::take_latest(frame, pdMS_TO_TICKS(1000)) == ESP_OK);
+        if (!frame) {
+            break;
+        }
+        taken++;
+
+        // The producer may have one more frame out of the driver that it has
+        // not published yet, but nothing older than that may be handed out
+        const int number = frame_number(frame);
+        const int newest = static_cast<int>(HostCamera::frames_delivered()) - 1;
+        CHECK(number > previous);
+        CHECK(newest - number <= 1);
+        previous = number;
+
+        // Processing that takes several frame periods
+        std::this_thread::sleep_for(std::chrono::milliseconds(6 * 1000 / FPS));
+    }
+
+    Capture::stop();
+    const Capture::Stats stats = Capture::get_stats();
+    CHECK(stats.failed == 0);
+    CHECK(stats.overwritten > 0);
+    CHECK(stats.captured >= stats.overwritten + taken);
+    CHECK(stats.captured <= stats.overwritten + taken + 1);
+
+    // Every buffer is back with the driver
+    {
+        Camera::FrameHandle held[Capture::FB_COUNT];
+        for (Camera::FrameHandle& frame : held) {
+            CHECK(Camera::get_frame(frame) == ESP_OK);
+        }
+    }
+    esp_camera_deinit();
+
+    return Test::result();
+}
@@ -0,0 +1,202 @@
+#include <random>
+#include <vector>
+#include "labeler.hpp"
+#include "test.hpp"
+#include "vision.hpp"
+
+/*
+ * Checks the run-length labeler against a plain 8-connected flood fill, on
+ * random masks and on masks with more blobs than it has room for.
+ */
+
+namespace {
+    constexpr int SIZE = 96;
+
+    using Mask = BitMask<SIZE, SIZE>;
+    using Labeler = Vision::Labeler<SIZE, SIZE>;
+
+    // Everything the flood fill knows about a blob
+    struct Expected {
+        int area;
+        Vision::Point top_left;
+        Vision::Point bottom_left;
+        long sum_x;
+        long sum_y;
+    };
+
+    // The blobs of rows [first_row, last_row), in raster order of their first pixel
+    std::vector<Expected> flood_fill(const Mask& mask, int first_row, int last_row)
+    {
+        static bool seen[SIZE][SIZE];
+        for (int y = 0; y < SIZE; y++) {
+            for (int x = 0; x < SIZE; x++) {
+                seen[y][x] = false;
+            }
+        }
+
+        std::vector<Expected> blobs;
+        std::vector<Vision::Point> stack;
+        for (int sy = first_row; sy < last_row; sy++) {
+            for (int sx = 0; sx < SIZE; sx++) {
+                if (!mask.get(sx, sy) || seen[sy][sx]) {
+                    continue;
+                }
+                Expected blob = {0, {sx, sy}, {sx, sy}, 0, 0};
+                seen[sy][sx] = true;
+                stack.push_back({sx, sy});
+                while (!stack.empty()) {
+                    const Vision::Point p = stack.back();
+                    stack.pop_back();
+                    blob.area++;
+                    blob.sum_x += p.x;
+                    blob.sum_y += p.y;
+                    if (p.y > blob.bottom_left.y || (p.y == blob.bottom_left.y && p.x < blob.bottom_left.x)) {
+                        blob.bottom_left = p;
+                    }
+                    for (int y = p.y - 1; y <= p.y + 1; y++) {
+                        for (int x = p.x - 1; x <= p.x + 1; x++) {
+                            if (y >= first_row && y < last_row && x >= 0 && x < SIZE && !seen[y][x]
+                                && mask.get(x, y)) {
+                                seen[y][x] = true;
+                                stack.push_back({x, y});
+                            }
+                        }
+                    }
+                }
+                blobs.push_back(blob);
+            }
+        }
+        return blobs;
+    }
+
+    bool same_blob(const Vision::Blob& blob, const Expected& expected)
+    {
+        return blob.area == expected.area
+            && blob.top_left.x == expected.top_left.x && blob.top_left.y == expected.top_left.y
+            && blob.bottom_left.x == expected.bottom_left.x && blob.bottom_left.y == expected.bottom_left.y
+            && blob.moments.m10 == expected.sum_x && blob.moments.m01 == expected.sum_y;
+    }
+
+    // Index of the largest expected blob, the first one on a tie
+    int largest(const std::vector<Expected>& blobs)
+    {
+        int best = -1;
+        for (size_t i = 0; i < blobs.size(); i++) {
+            if (best < 0 || blobs[i].area > blobs[best].area) {
+                best = static_cast<int>(i);
+            }
+        }
+        return best;
+    }
+
+    // Label a mask and compare every reported blob with the flood fill
+    void check_mask(Labeler& labeler, const Mask& mask, int first_row, int last_row)
+    {
+        const std::vector<Expected> expected = flood_fill(mask, first_row, last_row);
+        const int count = labeler.label(mask, first_row, last_row);
+        const int best = largest(expected);
+        const bool overflow = expected.size() > static_cast<size_t>(Labeler::MAX_BLOBS);
+
+        CHECK(labeler.overflowed() == overflow);
+        CHECK(count == (overflow ? Labeler::MAX_BLOBS : static_cast<int>(expected.size())));
+        if (best < 0) {
+            CHECK(labeler.largest() == -1);
+            return;
+        }
+
+        // The first blobs in raster order, with the largest one in the last slot if it did not fit
+        int mismatches = 0;
+        for (int i = 0; i < count; i++) {
+            const int index = i == count - 1 && best > i ? best : i;
+            mismatches += !same_blob(labeler.blob(i), expected[index]);
+        }
+        CHECK(mismatches == 0);
+        CHECK(labeler.largest() >= 0 && same_blob(labeler.blob(labeler.largest()), expected[best]));
+    }
+
+    void check_random_masks(Labeler& labeler)
+    {
+        static Mask mask;
+        std::mt19937 rng(16);
+        for (int i = 0; i < 300; i++) {
+            mask.clear();
+            const uint32_t density = rng() % 100;
+            for (int y = 0; y < SIZE; y++) {
+                for (int x = 0; x < SIZE; x++) {
+                    if (rng() % 100 < density) {
+                        mask.set(x, y);
+                    }
+                }
+            }
+            const int first_row = rng() % 50;
+            const int last_row = first_row + 1 + rng() % (SIZE - first_row);
+            check_mask(labeler, mask, first_row, last_row);
+        }
+    }
+
+    constexpr int LINE_X = 30;
+
+    // Isolated pixels on every other row and column from first_row on, then a
+    // two pixel wide line of line_rows rows below them
+    int speckled_mask(Mask& mask, int first_row, int specks, int line_rows)
+    {
+        constexpr int PER_ROW = SIZE / 2;
+        mask.clear();
+        for (int i = 0; i < specks; i++) {
+            mask.set(2 * (i % PER_ROW), first_row + 2 * (i / PER_ROW));
+        }
+        const int line_row = first_row + 2 * ((specks + PER_ROW - 1) / PER_ROW);
+        for (int y = line_row; y < line_row + line_rows && y < SIZE; y++) {
+            mask.set(LINE_X, y);
+            mask.set(LINE_X + 1, y);
+        }
+        return line_row;
+    }
+
+    void check_overflow(Labeler& labeler)
+    {
+        static Mask mask;
+
+        // The line comes long after MAX_BLOBS specks in raster order
+        speckled_mask(mask, 0, 480, 40);
+        check_mask(labeler, mask, 0, SIZE);
+        CHECK(labeler.overflowed());
+        CHECK(labeler.largest() == Labeler::MAX_BLOBS - 1);
+        CHECK(labeler.blob(labeler.largest()).area == 80);
+
+        // Exactly MAX_BLOBS blobs, so nothing is left out, then one more
+        speckled_mask(mask, 0, Labeler::MAX_BLOBS - 1, 10);
+        check_mask(labeler, mask, 0, SIZE);
+        CHECK(!labeler.overflowed());
+        speckled_mask(mask, 0, Labeler::MAX_BLOBS, 10);
+        check_mask(labeler, mask, 0, SIZE);
+        CHECK(labeler.overflowed());
+
+        // The same through the white line detector, below the crop row
+        const int line_row = speckled_mask(mask, Vision::WHITE_CROP_ROW + 1, 480, SIZE);
+        std::vector<uint8_t> frame(2 * SIZE * SIZE);
+        for (int y = 0; y < SIZE; y++) {
+            for (int x = 0; x < SIZE; x++) {
+                const uint8_t value = mask.get(x, y) ? 0xFF : 0x00;
+                frame[2 * (y * SIZE + x)] = value;
+                frame[2 * (y * SIZE + x) + 1] = value;
+            }
+        }
+        static Vision::WhiteLineDetector detector;
+        const Vision::SteeringResult line = detector.detect(Vision::Frame{frame.data(), SIZE, SIZE});
+        CHECK(detector.labeler().overflowed());
+        CHECK(line.found);
+        CHECK(line.area == 2 * (SIZE - line_row));
+        CHECK(line.top_left.x == LINE_X && line.top_left.y == line_row);
+        CHECK(line.steering == LINE_X - Vision::WHITELINE_CENTER_POS);
+    }
+}
+
+
+int main()
+{
+    static Labeler labeler;
+    check_random_masks(labeler);
+    check_overflow(labeler);
+    return Test::result();
+}
@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+#include "profile.hpp"
+#include "test.hpp"
+
+/*
+ * Checks the histogram buckets of profile.hpp and, when profiling is compiled
+ * in, that the stage summaries match the exact statistics of what was
+ * recorded.
+ */
+
+namespace {
+    // Every count falls in the bucket whose floor is the largest one not above it
+    void check_buckets()
+    {
+        int mismatches = 0;
+        for (uint32_t cycles = 0; cycles < 1u << 21; cycles++) {
+            const size_t bucket = Profile::bucket_of(cycles);
+            mismatches += Profile::bucket_floor(bucket) > cycles
+                || (bucket + 1 < Profile::BUCKET_COUNT && Profile::bucket_floor(bucket + 1) <= cycles);
+        }
+        CHECK(mismatches == 0);
+
+        // The edges of every bucket, up to the largest count
+        for (size_t bucket = 0; bucket < Profile::BUCKET_COUNT; bucket++) {
+            const uint32_t floor = Profile::bucket_floor(bucket);
+            CHECK(Profile::bucket_of(floor) == bucket);
+            if (floor > 0) {
+                CHECK(Profile::bucket_of(floor - 1) == bucket - 1);
+            }
+        }
+        CHECK(Profile::bucket_of(0xFFFFFFFF) == Profile::BUCKET_COUNT - 1);
+    }
+
+#if PROFILE_ENABLED
+    // Min, max, total and p99 of random stage times against sorting them
+    void check_summary()
+    {
+        std::mt19937 rng(24);
+        std::lognormal_distribution<double> cycles(10, 1);
+        for (int trial = 0; trial < 50; trial++) {
+            Profile::reset();
+            std::vector<uint32_t> times(1 + rng() % 20000);
+            uint64_t total = 0;
+            for (uint32_t& time : times) {
+                time = static_cast<uint32_t>(std::min(4e9, cycles(rng)));
+                total += time;
+                Profile::record(Profile::Stage::Segment, time);
+            }
+            std::sort(times.begin(), times.end());
+
+            const Profile::Summary summary = Profile::summarize(Profile::Stage::Segment);
+            CHECK(summary.count == times.size());
+            CHECK(summary.min == times.front());
+            CHECK(summary.max == times.back());
+            CHECK(summary.total == total);
+
+            // The time at the same rank, to within its bucket
+            const uint32_t exact = times[times.size() - times.size() / 100 - 1];
+            CHECK(Profile::bucket_of(summary.p99) == Profile::bucket_of(exact));
+            CHECK(summary.p99 >= summary.min && summary.p99 <= summary.max);
+        }
+
+        // Nothing recorded, nothing reported
+        Profile::reset();
+        const Profile::Summary empty = Profile::summarize(Profile::Stage::Segment);
+        CHECK(empty.count == 0 && empty.min == 0 && empty.max == 0 && empty.total == 0 && empty.p99 == 0);
+    }
+
+    // The total carries into its high word, also when threads record at once
+    void check_total_carry()
+    {
+        Profile::reset();
+        for (int i = 0; i < 5; i++) {
+            Profile::record(Profile::Stage::FileWrite, 0xF0000000);
+        }
+        const Profile::Summary large = Profile::summarize(Profile::Stage::FileWrite);
+        CHECK(large.total == 5ull * 0xF0000000);
+        CHECK(large.p99 == 0xF0000000);
+
+        constexpr int THREADS = 4;
+        constexpr int RECORDS = 300000;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < THREADS; i++) {
+            threads.emplace_back([] {
+                for (int j = 0; j < RECORDS; j++) {
+                    Profile::record(Profile::Stage::Queue, 4000);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        const Profile::Summary queue = Profile::summarize(Profile::Stage::Queue);
+        CHECK(queue.count == THREADS * RECORDS);
+        CHECK(queue.total == 4000ull * THREADS * RECORDS);
+        CHECK(queue.min == 4000 && queue.max == 4000 && queue.p99 == 4000);
+    }
+#endif
+}
+
+
+int main()
+{
+    check_buckets();
+#if PROFILE_ENABLED
+    check_summary();
+    check_total_carry();
+#endif
+    return Test::result();
+}
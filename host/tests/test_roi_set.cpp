@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "test.hpp"
+#include "vision.hpp"
+
+/*
+ * Checks RoiSet::evaluate against counting the class masks of the same
+ * segmentation with BitMask::count, for regions inside the frame and regions
+ * that reach past its edges, where only the part inside the frame counts.
+ */
+
+namespace {
+    constexpr int SIZE = 96;
+    constexpr int FRAME_COUNT = 200;
+    constexpr Vision::ClassBits CLASSES[] = {Vision::CLASS_RED, Vision::CLASS_WHITE, Vision::CLASS_GREEN};
+
+    // Random noise with a few solid rectangles of random colours on top
+    void random_frame(std::mt19937& rng, std::vector<uint8_t>& frame)
+    {
+        for (uint8_t& byte : frame) {
+            byte = static_cast<uint8_t>(rng());
+        }
+        for (int i = 0; i < 3; i++) {
+            const int x0 = rng() % (SIZE - 6);
+            const int y0 = rng() % (SIZE - 6);
+            const int x1 = x0 + rng() % 40;
+            const int y1 = y0 + rng() % 40;
+            const uint16_t code = static_cast<uint16_t>(rng());
+            for (int y = y0; y < y1 && y < SIZE; y++) {
+                for (int x = x0; x < x1 && x < SIZE; x++) {
+                    frame[2 * (y * SIZE + x)] = static_cast<uint8_t>(code >> 8);
+                    frame[2 * (y * SIZE + x) + 1] = static_cast<uint8_t>(code);
+                }
+            }
+        }
+    }
+
+    // A box with edges up to 20 pixels past the frame, possibly empty or entirely outside it
+    Vision::Rect random_box(std::mt19937& rng, bool inside)
+    {
+        const int margin = inside ? 0 : 20;
+        const int span = SIZE + 2 * margin;
+        const int x0 = static_cast<int>(rng() % span) - margin;
+        const int y0 = static_cast<int>(rng() % span) - margin;
+        const int x1 = x0 + static_cast<int>(rng() % (span - margin - x0 + 1));
+        const int y1 = y0 + static_cast<int>(rng() % (span - margin - y0 + 1));
+        return {x0, y0, x1, y1};
+    }
+
+    const Vision::Mask& mask_of(const Vision::Segmentation& segmentation, Vision::ClassBits cls)
+    {
+        return cls == Vision::CLASS_RED ? segmentation.red_mask
+            : cls == Vision::CLASS_WHITE ? segmentation.white_mask : segmentation.green_mask;
+    }
+
+    // Full sets of random regions over random frames
+    void check_random()
+    {
+        static Vision::Segmentation segmentation;
+        static Vision::Integrals integrals;
+        std::mt19937 rng(15);
+        std::vector<uint8_t> pixels(2 * SIZE * SIZE);
+        int mismatches = 0;
+        int clipped = 0;
+        int triggered = 0;
+        for (int i = 0; i < FRAME_COUNT; i++) {
+            random_frame(rng, pixels);
+            Vision::segment({pixels.data(), SIZE, SIZE}, segmentation, nullptr, &integrals);
+
+            Vision::RoiSet set;
+            Vision::Rect boxes[Vision::RoiSet::MAX_ROIS];
+            Vision::ClassBits classes[Vision::RoiSet::MAX_ROIS];
+            int thresholds[Vision::RoiSet::MAX_ROIS];
+            for (int r = 0; r < Vision::RoiSet::MAX_ROIS; r++) {
+                boxes[r] = random_box(rng, r % 2 == 0);
+                classes[r] = CLASSES[rng() % 3];
+                thresholds[r] = rng() % 101;
+                mismatches += set.add(boxes[r], classes[r], thresholds[r]) != r;
+            }
+            Vision::BoxResult results[Vision::RoiSet::MAX_ROIS];
+            set.evaluate(integrals, results);
+
+            for (int r = 0; r < Vision::RoiSet::MAX_ROIS; r++) {
+                const Vision::Rect& box = boxes[r];
+                const int x0 = std::max(box.x0, 0);
+                const int y0 = std::max(box.y0, 0);
+                const int x1 = std::min(box.x1, SIZE);
+                const int y1 = std::min(box.y1, SIZE);
+                const int total = x1 > x0 && y1 > y0 ? (x1 - x0) * (y1 - y0) : 0;
+                const int count = mask_of(segmentation, classes[r]).count(box.x0, box.y0, box.x1, box.y1);
+                const Vision::BoxResult& result = results[r];
+                mismatches += result.count != count || result.total != total;
+                if (total > 0) {
+                    mismatches += result.percent != count * 100 / total
+                        || result.triggered != (count * 100 >= thresholds[r] * total);
+                } else {
+                    mismatches += result.percent != 0 || result.triggered;
+                }
+                clipped += total != box.area();
+                triggered += result.triggered;
+            }
+        }
+        CHECK(mismatches == 0);
+
+        // Both kinds of region, and both decisions, were exercised
+        CHECK(clipped > FRAME_COUNT);
+        CHECK(triggered > 0 && triggered < FRAME_COUNT * Vision::RoiSet::MAX_ROIS);
+    }
+
+    // The detector boxes agree with the counts segment() keeps for them
+    void check_detector_boxes()
+    {
+        static Vision::Segmentation segmentation;
+        static Vision::Integrals integrals;
+        std::mt19937 rng(16);
+        std::vector<uint8_t> pixels(2 * SIZE * SIZE);
+
+        Vision::RoiSet set;
+        const int stop = set.add(Vision::STOPBOX, Vision::CLASS_RED, Vision::PERCENT_TO_STOP);
+        const int car = set.add(Vision::CARBOX, Vision::CLASS_GREEN, Vision::PERCENT_TO_CAR);
+        int mismatches = 0;
+        for (int i = 0; i < FRAME_COUNT; i++) {
+            random_frame(rng, pixels);
+            Vision::segment({pixels.data(), SIZE, SIZE}, segmentation, nullptr, &integrals);
+            Vision::BoxResult results[2];
+            set.evaluate(integrals, results);
+            const Vision::BoxResult expected[2] = {segmentation.stop_box(), segmentation.car_box()};
+            for (int r : {stop, car}) {
+                mismatches += results[r].count != expected[r].count || results[r].total != expected[r].total
+                    || results[r].percent != expected[r].percent || results[r].triggered != expected[r].triggered;
+            }
+        }
+        CHECK(mismatches == 0);
+    }
+
+    // A full set refuses more regions and keeps the ones it has
+    void check_capacity()
+    {
+        Vision::RoiSet set;
+        CHECK(set.size() == 0);
+        for (int r = 0; r < Vision::RoiSet::MAX_ROIS; r++) {
+            CHECK(set.add({r, r, r + 2, r + 2}, Vision::CLASS_WHITE, 50) == r);
+        }
+        CHECK(set.add({0, 0, 1, 1}, Vision::CLASS_WHITE, 50) == -1);
+        CHECK(set.size() == Vision::RoiSet::MAX_ROIS);
+    }
+}
+
+
+int main()
+{
+    check_random();
+    check_detector_boxes();
+    check_capacity();
+    return Test::result();
+}
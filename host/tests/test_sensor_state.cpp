@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#include <esp_log.h>
+#include "sensor_state.hpp"
+#include "test.hpp"
+
+/*
+ * Saves and restores the sensor registers through the host NVS stand-in, on
+ * fake OV2640 and OV3660 sensors that check the auto loops are held in
+ * manual mode while the stored values are written.
+ */
+
+namespace {
+    // The registers SensorState stores for each sensor, with the bits it keeps
+    struct Reg {
+        int addr;
+        int mask;
+    };
+
+    constexpr Reg OV2640_REGS[] = {{0x100, 0xFF}, {0x104, 0x03}, {0x110, 0xFF}, {0x145, 0x3F}};
+
+    constexpr Reg OV3660_REGS[] = {
+        {0x3400, 0x0F}, {0x3401, 0xFF}, {0x3402, 0x0F}, {0x3403, 0xFF}, {0x3404, 0x0F}, {0x3405, 0xFF},
+        {0x3500, 0x0F}, {0x3501, 0xFF}, {0x3502, 0xFF}, {0x350A, 0x03}, {0x350B, 0xFF},
+    };
+
+    // Auto-control bits and their value in manual mode
+    struct Mode {
+        int addr;
+        int mask;
+        int manual;
+    };
+
+    constexpr Mode OV2640_MODES[] = {{0x113, 0x05, 0x00}};
+    constexpr Mode OV3660_MODES[] = {{0x3406, 0x01, 0x01}, {0x3503, 0x03, 0x03}};
+
+    const std::string BLOB_PATH = std::string(HOST_NVS_DIR "/") + SensorState::NVS_NAMESPACE + "/"
+                                + SensorState::NVS_KEY;
+
+    struct FakeSensor {
+        sensor_t sensor;
+        std::map<int, int> registers;
+        int writes = 0;             ///< Writes to registers other than the auto-control ones
+        int automatic_writes = 0;   ///< Of those, writes made while an auto loop was running
+    };
+
+    std::map<const sensor_t*, FakeSensor*> fakes;
+
+    template <size_t N>
+    bool is_mode_reg(const Mode (&modes)[N], int addr)
+    {
+        for (const Mode& mode : modes) {
+            if (mode.addr == addr) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <size_t N>
+    bool is_manual(const Mode (&modes)[N], std::map<int, int>& registers)
+    {
+        for (const Mode& mode : modes) {
+            if ((registers[mode.addr] & mode.mask) != mode.manual) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int get_reg(sensor_t* sensor, int reg, int mask)
+    {
+        return fakes[sensor]->registers[reg] & mask;
+    }
+
+    int set_reg(sensor_t* sensor, int reg, int mask, int value)
+    {
+        FakeSensor& fake = *fakes[sensor];
+        const bool ov2640 = sensor->id.PID == OV2640_PID;
+        if (ov2640 ? !is_mode_reg(OV2640_MODES, reg) : !is_mode_reg(OV3660_MODES, reg)) {
+            fake.writes++;
+            const bool manual = ov2640 ? is_manual(OV2640_MODES, fake.registers)
+                                       : is_manual(OV3660_MODES, fake.registers);
+            fake.automatic_writes += !manual;
+        }
+        fake.registers[reg] = (fake.registers[reg] & ~mask) | (value & mask);
+        return 0;
+    }
+
+    void make_sensor(FakeSensor& fake, uint16_t pid)
+    {
+        fake.sensor = {{0x7F, 0xA2, pid, 0x42}, get_reg, set_reg, nullptr};
+        fakes[&fake.sensor] = &fake;
+
+        // Auto loops running, as after reset
+        if (pid == OV2640_PID) {
+            fake.registers[0x113] = 0xE5;
+        } else {
+            fake.registers[0x3406] = 0x00;
+            fake.registers[0x3503] = 0x00;
+        }
+    }
+
+    // Distinct values in every bit each register keeps
+    template <size_t N>
+    void fill(FakeSensor& fake, const Reg (&regs)[N], int seed)
+    {
+        for (size_t i = 0; i < N; i++) {
+            fake.registers[regs[i].addr] = (0x5A + seed * 17 + static_cast<int>(i) * 29) & 0xFF;
+        }
+    }
+
+    template <size_t N>
+    bool same_regs(FakeSensor& a, FakeSensor& b, const Reg (&regs)[N])
+    {
+        for (const Reg& reg : regs) {
+            if ((a.registers[reg.addr] & reg.mask) != (b.registers[reg.addr] & reg.mask)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Backdate the stored blob, so a rewrite shows up as a new modification time
+    time_t backdate_blob()
+    {
+        const time_t old = 1000000;
+        const utimbuf times = {old, old};
+        utime(BLOB_PATH.c_str(), &times);
+        return old;
+    }
+
+    time_t blob_mtime()
+    {
+        struct stat st;
+        return stat(BLOB_PATH.c_str(), &st) == 0 ? st.st_mtime : 0;
+    }
+
+    void write_blob(const void* data, size_t length)
+    {
+        FILE* out = fopen(BLOB_PATH.c_str(), "wb");
+        fwrite(data, 1, length, out);
+        fclose(out);
+    }
+
+    template <size_t RegCount, size_t ModeCount>
+    void check_round_trip(uint16_t pid, const Reg (&regs)[RegCount], const Mode (&modes)[ModeCount])
+    {
+        CHECK(SensorState::clear() == ESP_OK);
+
+        FakeSensor settled;
+        make_sensor(settled, pid);
+        fill(settled, regs, pid & 0xFF);
+        CHECK(SensorState::save(&settled.sensor) == ESP_OK);
+
+        FakeSensor booted;
+        make_sensor(booted, pid);
+        const std::map<int, int> modes_before = booted.registers;
+        CHECK(SensorState::restore(&booted.sensor) == ESP_OK);
+        CHECK(same_regs(settled, booted, regs));
+        CHECK(booted.writes == static_cast<int>(RegCount));
+        CHECK(booted.automatic_writes == 0);
+
+        // The auto loops are running again afterwards
+        for (const Mode& mode : modes) {
+            CHECK(booted.registers[mode.addr] == modes_before.at(mode.addr));
+        }
+
+        // Saving the same values again leaves the blob alone
+        const time_t old = backdate_blob();
+        CHECK(SensorState::save(&settled.sensor) == ESP_OK);
+        CHECK(blob_mtime() == old);
+
+        // A changed value is written
+        settled.registers[regs[0].addr] ^= regs[0].mask;
+        CHECK(SensorState::save(&settled.sensor) == ESP_OK);
+        CHECK(blob_mtime() != old);
+        FakeSensor rebooted;
+        make_sensor(rebooted, pid);
+        CHECK(SensorState::restore(&rebooted.sensor) == ESP_OK);
+        CHECK(same_regs(settled, rebooted, regs));
+    }
+
+    // A missing or unusable snapshot is ESP_ERR_NOT_FOUND and leaves the sensor alone
+    void check_unusable_snapshots()
+    {
+        FakeSensor settled;
+        make_sensor(settled, OV2640_PID);
+        fill(settled, OV2640_REGS, 1);
+
+        FakeSensor booted;
+        make_sensor(booted, OV2640_PID);
+
+        CHECK(SensorState::clear() == ESP_OK);
+        CHECK(SensorState::restore(&booted.sensor) == ESP_ERR_NOT_FOUND);
+
+        // Cut short
+        CHECK(SensorState::save(&settled.sensor) == ESP_OK);
+        FILE* in = fopen(BLOB_PATH.c_str(), "rb");
+        uint8_t blob[64] = {};
+        const size_t length = fread(blob, 1, sizeof(blob), in);
+        fclose(in);
+        write_blob(blob, length / 2);
+        CHECK(SensorState::restore(&booted.sensor) == ESP_ERR_NOT_FOUND);
+
+        // Written by another snapshot version
+        uint8_t corrupt[64];
+        std::copy(blob, blob + length, corrupt);
+        corrupt[0] ^= 0xFF;
+        write_blob(corrupt, length);
+        CHECK(SensorState::restore(&booted.sensor) == ESP_ERR_NOT_FOUND);
+
+        // Saved from a different sensor
+        FakeSensor other;
+        make_sensor(other, OV3660_PID);
+        fill(other, OV3660_REGS, 2);
+        CHECK(SensorState::save(&other.sensor) == ESP_OK);
+        CHECK(SensorState::restore(&booted.sensor) == ESP_ERR_NOT_FOUND);
+
+        CHECK(booted.writes == 0);
+        CHECK(booted.registers.size() == 1);
+
+        // A corrupt blob is replaced by the next save
+        write_blob(corrupt, length);
+        CHECK(SensorState::save(&settled.sensor) == ESP_OK);
+        CHECK(SensorState::restore(&booted.sensor) == ESP_OK);
+        CHECK(same_regs(settled, booted, OV2640_REGS));
+    }
+}
+
+
+int main()
+{
+    // The snapshots rejected on purpose would each log a warning
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    const std::string dir = Test::temp_dir("test_sensor_state");
+    if (chdir(dir.c_str()) != 0) {
+        perror("chdir");
+        return 1;
+    }
+    CHECK(SensorState::init_nvs() == ESP_OK);
+
+    // No namespace at all on a fresh partition
+    FakeSensor fresh;
+    make_sensor(fresh, OV2640_PID);
+    CHECK(SensorState::restore(&fresh.sensor) == ESP_ERR_NOT_FOUND);
+
+    check_round_trip(OV2640_PID, OV2640_REGS, OV2640_MODES);
+    check_round_trip(OV3660_PID, OV3660_REGS, OV3660_MODES);
+    check_round_trip(OV5640_PID, OV3660_REGS, OV3660_MODES);
+    check_unusable_snapshots();
+
+    return Test::result();
+}
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+#include "swar.hpp"
+#include "test.hpp"
+
+/*
+ * Checks the two pixel kernels of Swar against the one pixel functions they
+ * replace, for every pair of codes, so no carry or borrow between the lanes
+ * can go unnoticed.
+ */
+
+namespace {
+    constexpr int CODES = 1 << 16;
+
+    // The scalar results for every code
+    struct Expected {
+        uint32_t classes[CODES];
+        uint32_t red[CODES];
+        uint32_t green[CODES];
+        uint32_t blue[CODES];
+    };
+
+    // Pairs with a high lane in [first, last) that the kernels get wrong
+    long check_lanes(const Expected& expected, uint32_t first, uint32_t last)
+    {
+        long mismatches = 0;
+        for (uint32_t high = first; high < last; high++) {
+            const uint32_t classes = expected.classes[high] << 16;
+            const uint32_t red = expected.red[high] << 16;
+            const uint32_t green = expected.green[high] << 16;
+            const uint32_t blue = expected.blue[high] << 16;
+            for (uint32_t low = 0; low < CODES; low++) {
+                const uint32_t codes = (high << 16) | low;
+                mismatches += (Swar::classify_pair(codes) != (classes | expected.classes[low]))
+                    | (Swar::red8(codes) != (red | expected.red[low]))
+                    | (Swar::green8(codes) != (green | expected.green[low]))
+                    | (Swar::blue8(codes) != (blue | expected.blue[low]));
+            }
+        }
+        return mismatches;
+    }
+
+    // All 2^32 pairs, split by high lane across the cores
+    long check_all_pairs(const Expected& expected)
+    {
+        const int thread_count = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        std::vector<long> mismatches(thread_count, 0);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < thread_count; i++) {
+            threads.emplace_back([&, i] {
+                mismatches[i] = check_lanes(expected, CODES * i / thread_count, CODES * (i + 1) / thread_count);
+            });
+        }
+        long total = 0;
+        for (int i = 0; i < thread_count; i++) {
+            threads[i].join();
+            total += mismatches[i];
+        }
+        return total;
+    }
+
+    // load_pair puts each code in its lane whatever the other one holds
+    void check_load_pair()
+    {
+        int mismatches = 0;
+        for (uint32_t code = 0; code < CODES; code++) {
+            const uint32_t other = code ^ 0xA5C3;
+            const uint8_t px[5] = {0, static_cast<uint8_t>(code >> 8), static_cast<uint8_t>(code),
+                                   static_cast<uint8_t>(other >> 8), static_cast<uint8_t>(other)};
+            // Unaligned, as a row of an odd width can be
+            mismatches += Swar::load_pair(px + 1) != ((other << 16) | code);
+        }
+        CHECK(mismatches == 0);
+    }
+
+    // The row functions, including the odd pixel at the end
+    void check_rows()
+    {
+        std::mt19937 rng(20);
+        std::vector<uint8_t> px(2 * 97);
+        std::vector<uint8_t> classes(97);
+        std::vector<uint8_t> red(97);
+        std::vector<uint8_t> green(97);
+        std::vector<uint8_t> blue(97);
+        int mismatches = 0;
+        for (int i = 0; i < 1000; i++) {
+            const int count = 1 + rng() % 97;
+            for (int j = 0; j < 2 * count; j++) {
+                px[j] = static_cast<uint8_t>(rng());
+            }
+            Swar::classify_row(px.data(), count, classes.data());
+            Swar::extract_channels(px.data(), count, red.data(), green.data(), blue.data());
+            for (int x = 0; x < count; x++) {
+                const uint16_t code = RGB565::code(&px[2 * x]);
+                mismatches += classes[x] != Vision::classify(code) || red[x] != RGB565::red8(code)
+                    || green[x] != RGB565::green8(code) || blue[x] != RGB565::blue8(code);
+            }
+        }
+        CHECK(mismatches == 0);
+    }
+}
+
+
+int main()
+{
+    static Expected expected;
+    for (int code = 0; code < CODES; code++) {
+        expected.classes[code] = Vision::classify(static_cast<uint16_t>(code));
+        expected.red[code] = RGB565::red8(static_cast<uint16_t>(code));
+        expected.green[code] = RGB565::green8(static_cast<uint16_t>(code));
+        expected.blue[code] = RGB565::blue8(static_cast<uint16_t>(code));
+    }
+
+    CHECK(check_all_pairs(expected) == 0);
+    check_load_pair();
+    check_rows();
+    return Test::result();
+}
@@ -0,0 +1,340 @@
+#include <cstdint>
+#include <random>
+#include <tuple>
+#include <vector>
+#include "class_lut.hpp"
+#include "test.hpp"
+#include "vision.hpp"
+
+/*
+ * Checks the firmware detectors against openimages.py. The Python code is
+ * transliterated below as directly as possible, float arithmetic included,
+ * and both are run on every RGB565 code and on random frames.
+ */
+
+namespace {
+    constexpr int SIZE = 96;
+    constexpr int FRAMES = 200;
+
+    // openimages.py, step by step on one image
+    namespace Reference {
+        struct Image {
+            int rgb[SIZE][SIZE][3];
+        };
+
+        // rgb565_to_rgb888: r / 32 * 255 in float64, then astype(np.uint16)
+        void to_rgb888(const uint8_t* raw, int* rgb)
+        {
+            const int r = (raw[0] & 0xF8) >> 3;
+            const int g = ((raw[0] & 0x07) << 3) | ((raw[1] & 0xE0) >> 5);
+            const int b = raw[1] & 0x1F;
+            rgb[0] = static_cast<int>(r / 32.0 * 255);
+            rgb[1] = static_cast<int>(g / 64.0 * 255);
+            rgb[2] = static_cast<int>(b / 32.0 * 255);
+        }
+
+        void open_image(const std::vector<uint8_t>& raw, Image& image)
+        {
+            for (int y = 0; y < SIZE; y++) {
+                for (int x = 0; x < SIZE; x++) {
+                    to_rgb888(&raw[2 * (y * SIZE + x)], image.rgb[y][x]);
+                }
+            }
+        }
+
+        // applyRedMask
+        bool red(const int* p)
+        {
+            return p[0] > p[1] + 20 && p[0] > p[2] + 30;
+        }
+
+        // drawStopBox: the percentage of red pixels in the box, and whether it means stop
+        bool stop_box(const Image& image, int& red_pixels)
+        {
+            red_pixels = 0;
+            for (int y = 75; y < 90; y++) {
+                for (int x = 45; x < 70; x++) {
+                    red_pixels += red(image.rgb[y][x]);
+                }
+            }
+            const double percent_red = static_cast<double>(red_pixels) / (15 * 25) * 100;
+            return percent_red >= 10;
+        }
+
+        // processCarImg
+        bool green(const int* p)
+        {
+            return p[1] > p[0] + 50 && p[1] > p[2] + 30;
+        }
+
+        // drawCarBox: the percentage of green pixels in the box, and whether a car is there
+        bool car_box(const Image& image, int& car_pixels)
+        {
+            car_pixels = 0;
+            for (int y = 40; y < 70; y++) {
+                for (int x = 0; x < 15; x++) {
+                    car_pixels += green(image.rgb[y][x]);
+                }
+            }
+            const double percent_car = static_cast<double>(car_pixels) / (30 * 15) * 100;
+            return percent_car >= 10;
+        }
+
+        // applyWhiteMask
+        bool white(const int* p)
+        {
+            return p[0] > 180 && p[1] > 180 && p[2] > 110;
+        }
+
+        struct WhiteLine {
+            bool found;
+            bool tie;       ///< Two blobs share the largest area
+            int area;
+            Vision::Point centroid;
+            Vision::Point top_left;
+            Vision::Point bottom_left;
+            int steering;
+        };
+
+        // processWhiteImgV2: crop rows up to 45, mask, take the largest
+        // 8-connected blob and its top-left-most and bottom-left-most points.
+        // Blobs are ranked and their centroid taken by pixel, where OpenCV
+        // uses the outer contour, as the firmware documents.
+        WhiteLine white_line(const Image& image)
+        {
+            static int label[SIZE][SIZE];
+            WhiteLine best = {};
+            int blobs = 0;
+            for (int y = 0; y < SIZE; y++) {
+                for (int x = 0; x < SIZE; x++) {
+                    label[y][x] = -1;
+                }
+            }
+
+            for (int sy = 46; sy < SIZE; sy++) {
+                for (int sx = 0; sx < SIZE; sx++) {
+                    if (!white(image.rgb[sy][sx]) || label[sy][sx] >= 0) {
+                        continue;
+                    }
+
+                    // Flood fill one blob
+                    WhiteLine blob = {true, false, 0, {0, 0}, {sx, sy}, {sx, sy}, 0};
+                    long sum_x = 0;
+                    long sum_y = 0;
+                    std::vector<std::pair<int, int>> stack = {{sx, sy}};
+                    label[sy][sx] = blobs;
+                    while (!stack.empty()) {
+                        const auto [x, y] = stack.back();
+                        stack.pop_back();
+                        blob.area++;
+                        sum_x += x;
+                        sum_y += y;
+                        if (std::make_tuple(y, x) < std::make_tuple(blob.top_left.y, blob.top_left.x)) {
+                            blob.top_left = {x, y};
+                        }
+                        if (std::make_tuple(y, -x) > std::make_tuple(blob.bottom_left.y, -blob.bottom_left.x)) {
+                            blob.bottom_left = {x, y};
+                        }
+                        for (int ny = y - 1; ny <= y + 1; ny++) {
+                            for (int nx = x - 1; nx <= x + 1; nx++) {
+                                if (ny > 45 && ny < SIZE && nx >= 0 && nx < SIZE && label[ny][nx] < 0
+                                    && white(image.rgb[ny][nx])) {
+                                    label[ny][nx] = blobs;
+                                    stack.push_back({nx, ny});
+                                }
+                            }
+                        }
+                    }
+                    blobs++;
+
+                    // int(M["m10"] / M["m00"])
+                    blob.centroid = {static_cast<int>(sum_x / blob.area), static_cast<int>(sum_y / blob.area)};
+                    // steeringValue with CENTER_WEIGHT = 1, WIDTH_WEIGHT = 0
+                    blob.steering = blob.top_left.x - 28;
+                    if (blob.area > best.area) {
+                        best = blob;
+                    } else if (blob.area == best.area) {
+                        best.tie = true;
+                    }
+                }
+            }
+            return best;
+        }
+    }
+
+    // Random pixels, with a patch of the colour under test dropped in around
+    // a box at a random size so its percentage lands on both sides of the threshold
+    std::vector<uint8_t> random_frame(std::mt19937& rng, const Vision::Rect& box, int r5, int g6, int b5)
+    {
+        // Dark grey noise with one pixel in eight of any colour
+        std::vector<uint8_t> frame(2 * SIZE * SIZE);
+        for (size_t i = 0; i < frame.size(); i += 2) {
+            const uint32_t bits = rng();
+            const int grey = (bits & 0x1F) % 20;
+            const uint16_t code = (bits >> 5) % 8 == 0
+                ? static_cast<uint16_t>(bits >> 16)
+                : static_cast<uint16_t>((grey << 11) | (grey << 6) | grey);
+            frame[i] = code >> 8;
+            frame[i + 1] = code & 0xFF;
+        }
+
+        const Vision::Rect near = box.dilated(8).clipped({0, 0, SIZE, SIZE});
+        const int x0 = near.x0 + static_cast<int>(rng() % (near.x1 - near.x0));
+        const int y0 = near.y0 + static_cast<int>(rng() % (near.y1 - near.y0));
+        const int x1 = x0 + rng() % 16;
+        const int y1 = y0 + rng() % 16;
+        for (int y = y0; y < y1 && y < SIZE; y++) {
+            for (int x = x0; x < x1 && x < SIZE; x++) {
+                // Jitter the low bits so the patch straddles the thresholds
+                const int r = r5 ^ (rng() & 3);
+                const int g = g6 ^ (rng() & 7);
+                const int b = b5 ^ (rng() & 3);
+                const uint16_t code = static_cast<uint16_t>((r << 11) | (g << 5) | b);
+                frame[2 * (y * SIZE + x)] = code >> 8;
+                frame[2 * (y * SIZE + x) + 1] = code & 0xFF;
+            }
+        }
+        return frame;
+    }
+
+    void check_widening()
+    {
+        int mismatches = 0;
+        for (uint32_t code = 0; code < 0x10000; code++) {
+            const uint8_t raw[2] = {static_cast<uint8_t>(code >> 8), static_cast<uint8_t>(code)};
+            int rgb[3];
+            Reference::to_rgb888(raw, rgb);
+            mismatches += RGB565::red8(code) != rgb[0] || RGB565::green8(code) != rgb[1]
+                       || RGB565::blue8(code) != rgb[2];
+            mismatches += Vision::is_red(code) != Reference::red(rgb);
+            mismatches += Vision::is_white(code) != Reference::white(rgb);
+            mismatches += Vision::is_green(code) != Reference::green(rgb);
+        }
+        CHECK(mismatches == 0);
+    }
+
+    void check_stop_box(std::mt19937& rng)
+    {
+        static Reference::Image image;
+        static Vision::Segmentation segmentation;
+        int mismatches = 0;
+        int triggered = 0;
+        for (int i = 0; i < FRAMES; i++) {
+            const std::vector<uint8_t> raw = random_frame(rng, Vision::STOPBOX, 28, 12, 6);
+            const Vision::Frame frame = {raw.data(), SIZE, SIZE};
+            Reference::open_image(raw, image);
+
+            int red_pixels;
+            const bool stop = Reference::stop_box(image, red_pixels);
+            triggered += stop;
+
+            const Vision::BoxResult full = Vision::detect_stop_box(frame, false);
+            const Vision::BoxResult early = Vision::detect_stop_box(frame);
+            mismatches += full.count != red_pixels || full.triggered != stop || early.triggered != stop;
+
+            // The fused pass, with and without the lookup table
+            for (const uint8_t* lut : {static_cast<const uint8_t*>(nullptr), ClassLut::table()}) {
+                Vision::segment(frame, segmentation, lut);
+                mismatches += segmentation.stop_red != red_pixels || segmentation.stop_box().triggered != stop;
+                for (int y = 0; y < SIZE; y++) {
+                    for (int x = 0; x < SIZE; x++) {
+                        mismatches += segmentation.red_mask.get(x, y) != Reference::red(image.rgb[y][x]);
+                    }
+                }
+            }
+        }
+        CHECK(mismatches == 0);
+
+        // Both outcomes were exercised
+        CHECK(triggered > 0 && triggered < FRAMES);
+    }
+
+    void check_car_box(std::mt19937& rng)
+    {
+        static Reference::Image image;
+        static Vision::Segmentation segmentation;
+        int mismatches = 0;
+        int triggered = 0;
+        for (int i = 0; i < FRAMES; i++) {
+            const std::vector<uint8_t> raw = random_frame(rng, Vision::CARBOX, 6, 50, 8);
+            const Vision::Frame frame = {raw.data(), SIZE, SIZE};
+            Reference::open_image(raw, image);
+
+            int car_pixels;
+            const bool car = Reference::car_box(image, car_pixels);
+            triggered += car;
+
+            const Vision::BoxResult full = Vision::detect_car_box(frame, false);
+            const Vision::BoxResult early = Vision::detect_car_box(frame);
+            mismatches += full.count != car_pixels || full.triggered != car || early.triggered != car;
+
+            for (const uint8_t* lut : {static_cast<const uint8_t*>(nullptr), ClassLut::table()}) {
+                Vision::segment(frame, segmentation, lut);
+                mismatches += segmentation.car_green != car_pixels || segmentation.car_box().triggered != car;
+                for (int y = 0; y < SIZE; y++) {
+                    for (int x = 0; x < SIZE; x++) {
+                        mismatches += segmentation.green_mask.get(x, y) != Reference::green(image.rgb[y][x]);
+                    }
+                }
+            }
+        }
+        CHECK(mismatches == 0);
+        CHECK(triggered > 0 && triggered < FRAMES);
+    }
+
+    bool same_line(const Vision::SteeringResult& line, const Reference::WhiteLine& expected)
+    {
+        if (line.found != expected.found) {
+            return false;
+        }
+        return !line.found
+            || (line.area == expected.area && line.steering == expected.steering
+                && line.centroid.x == expected.centroid.x && line.centroid.y == expected.centroid.y
+                && line.top_left.x == expected.top_left.x && line.top_left.y == expected.top_left.y
+                && line.bottom_left.x == expected.bottom_left.x && line.bottom_left.y == expected.bottom_left.y);
+    }
+
+    void check_white_line(std::mt19937& rng)
+    {
+        static Reference::Image image;
+        static Vision::Segmentation segmentation;
+        static Vision::WhiteLineDetector detector;
+        const Vision::Rect below_crop = {0, Vision::WHITE_CROP_ROW + 1, SIZE, SIZE};
+        int mismatches = 0;
+        int compared = 0;
+        for (int i = 0; i < FRAMES; i++) {
+            const std::vector<uint8_t> raw = random_frame(rng, below_crop, 30, 60, 28);
+            const Vision::Frame frame = {raw.data(), SIZE, SIZE};
+            Reference::open_image(raw, image);
+
+            // With two blobs of the same size either one is a valid answer
+            const Reference::WhiteLine expected = Reference::white_line(image);
+            if (expected.tie) {
+                continue;
+            }
+            compared++;
+
+            mismatches += !same_line(detector.detect(frame), expected);
+            Vision::segment(frame, segmentation);
+            mismatches += !same_line(detector.detect(segmentation), expected);
+            for (int y = Vision::WHITE_CROP_ROW + 1; y < SIZE; y++) {
+                for (int x = 0; x < SIZE; x++) {
+                    mismatches += segmentation.white_mask.get(x, y) != Reference::white(image.rgb[y][x]);
+                }
+            }
+        }
+        CHECK(mismatches == 0);
+        CHECK(compared > FRAMES / 2);
+    }
+}
+
+
+int main()
+{
+    std::mt19937 rng(9);
+    check_widening();
+    check_stop_box(rng);
+    check_white_line(rng);
+    check_car_box(rng);
+    return Test::result();
+}
@@ -0,0 +1,148 @@
+#include <string>
+#include <vector>
+#include <esp_camera.h>
+#include <esp_log.h>
+#include "camera.hpp"
+#include "host_camera.hpp"
+#include "test.hpp"
+#include "warmup.hpp"
+
+/*
+ * Replays recorded warm-up sequences through Warmup::Controller and checks
+ * when it reports the sensor as settled. The sequences are written as
+ * IMAGE{n}.BIN captures, like the ones saved on the card, and read back.
+ */
+
+namespace {
+    constexpr size_t FRAME_BYTES = HostCamera::FRAME_SIZE * HostCamera::FRAME_SIZE * 2;
+
+    // Frames of the settling sequence that are still changing
+    constexpr int SETTLE_FRAMES = 6;
+
+    struct Colour {
+        int r5;
+        int g6;
+        int b5;
+    };
+
+    // A flat frame, with every other pixel nudged by one step to look like sensor noise
+    std::vector<uint8_t> flat_frame(const Colour& colour, bool noisy)
+    {
+        std::vector<uint8_t> frame(FRAME_BYTES);
+        for (size_t i = 0; i < FRAME_BYTES; i += 2) {
+            const int nudge = noisy && (i / 2) % 2 ? 1 : 0;
+            const uint16_t code = static_cast<uint16_t>((colour.r5 << 11) | ((colour.g6 - nudge) << 5) | colour.b5);
+            frame[i] = static_cast<uint8_t>(code >> 8);
+            frame[i + 1] = static_cast<uint8_t>(code);
+        }
+        return frame;
+    }
+
+    // A strong yellow tint that fades to neutral grey, then holds
+    std::vector<std::vector<uint8_t>> settling_sequence(int length)
+    {
+        std::vector<std::vector<uint8_t>> frames;
+        for (int i = 0; i < length; i++) {
+            const int fade = i < SETTLE_FRAMES ? SETTLE_FRAMES - i : 0;
+            frames.push_back(flat_frame({16 + 2 * fade, 32 + 4 * fade, 16 - 2 * fade}, true));
+        }
+        return frames;
+    }
+
+    // Flickers between two tints and never settles
+    std::vector<std::vector<uint8_t>> flicker_sequence(int length)
+    {
+        std::vector<std::vector<uint8_t>> frames;
+        for (int i = 0; i < length; i++) {
+            frames.push_back(flat_frame(i % 2 ? Colour{28, 56, 8} : Colour{16, 32, 16}, false));
+        }
+        return frames;
+    }
+
+    // Already settled from the first frame
+    std::vector<std::vector<uint8_t>> stable_sequence(int length)
+    {
+        return std::vector<std::vector<uint8_t>>(length, flat_frame({16, 32, 16}, true));
+    }
+
+    // Save a sequence as captures in a fresh directory
+    std::string record(const char* name, const std::vector<std::vector<uint8_t>>& frames)
+    {
+        const std::string dir = Test::temp_dir(name);
+        for (size_t i = 0; i < frames.size(); i++) {
+            const std::string path = dir + "/IMAGE" + std::to_string(i) + ".BIN";
+            FILE* out = fopen(path.c_str(), "wb");
+            fwrite(frames[i].data(), 1, frames[i].size(), out);
+            fclose(out);
+        }
+        return dir;
+    }
+
+    // Feed the captures of a directory to a controller until it is done
+    Warmup::Controller replay(const std::string& dir, const Warmup::Config& config)
+    {
+        Warmup::Controller controller(config);
+        std::vector<uint8_t> frame(FRAME_BYTES);
+        for (int i = 0; !controller.done(); i++) {
+            const std::string path = dir + "/IMAGE" + std::to_string(i) + ".BIN";
+            FILE* in = fopen(path.c_str(), "rb");
+            if (!in) {
+                break;
+            }
+            const size_t length = fread(frame.data(), 1, frame.size(), in);
+            fclose(in);
+            controller.update(frame.data(), length);
+        }
+        return controller;
+    }
+}
+
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_WARN);
+    Warmup::Config config;
+    config.max_frames = 20;
+
+    // The tint stops moving at frame SETTLE_FRAMES, which needs stable_frames more to confirm
+    const std::string settling = record("test_warmup_settling", settling_sequence(30));
+    const Warmup::Controller settled = replay(settling, config);
+    CHECK(settled.done());
+    CHECK(settled.converged());
+    CHECK(settled.frames() == SETTLE_FRAMES + config.stable_frames + 1);
+    CHECK(settled.last_stats().chroma_ratio < 300);
+
+    // Flicker never settles, so warm-up gives up at the cap
+    const Warmup::Controller flicker = replay(record("test_warmup_flicker", flicker_sequence(30)), config);
+    CHECK(flicker.done());
+    CHECK(!flicker.converged());
+    CHECK(flicker.frames() == config.max_frames);
+
+    // Stable from the start: done as soon as stable_frames frames agree, but not before min_frames
+    const std::string stable = record("test_warmup_stable", stable_sequence(30));
+    const Warmup::Controller immediate = replay(stable, config);
+    CHECK(immediate.converged());
+    CHECK(immediate.frames() == config.stable_frames + 1);
+    Warmup::Config patient = config;
+    patient.min_frames = 7;
+    const Warmup::Controller waited = replay(stable, patient);
+    CHECK(waited.converged());
+    CHECK(waited.frames() == patient.min_frames);
+
+    // A sequence that runs out before the cap leaves the controller waiting
+    const Warmup::Controller short_run = replay(record("test_warmup_short", settling_sequence(4)), config);
+    CHECK(!short_run.done());
+    CHECK(short_run.frames() == 4);
+
+    // The same settling sequence through the replayed camera, as on boot
+    HostCamera::Config camera;
+    camera.directory = settling.c_str();
+    CHECK(HostCamera::configure(camera) == ESP_OK);
+    Camera::config_cam();
+    bool converged = false;
+    CHECK(Warmup::run(config, &converged) == SETTLE_FRAMES + config.stable_frames + 1);
+    CHECK(converged);
+    esp_camera_deinit();
+
+    return Test::result();
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <esp_err.h>
+#include "constants.hpp"
+
+/**
+ * @brief Sequential file writer that only issues whole-sector writes
+ *
+ * Writes are collected in a DMA-capable buffer one allocation unit long and
+ * handed to the filesystem in multiples of SD_SECTOR_SIZE, so FATFS never
+ * has to read-modify-write a sector or bounce the data through its own
+ * buffer. Only the tail flushed on close() can be a partial sector.
+ */
+class AlignedWriter {
+public:
+    /// @brief Tag used in ESP debug logs
+    static constexpr const char* TAG = "ALIGNED_WRITER";
+
+    /// @brief Counters for judging how much extra work the card does per payload byte
+    struct Stats {
+        uint64_t payload_bytes;         ///< Bytes passed to write() and pad_to_sector()
+        uint64_t device_bytes;          ///< Bytes handed to the filesystem, including rewrites
+        uint32_t write_calls;           ///< Writes issued to the filesystem
+        uint32_t partial_sector_writes; ///< Writes that did not start and end on a sector boundary
+    };
+
+    AlignedWriter() = default;
+    ~AlignedWriter() { close(); }
+
+    AlignedWriter(const AlignedWriter&) = delete;
+    AlignedWriter& operator=(const AlignedWriter&) = delete;
+
+    /**
+     * @brief Create a new file, replacing any existing one
+     *
+     * @param path - Where to create the file
+     * @param preallocate - Bytes to reserve as one contiguous extent up front, 0 for none
+     * @return esp_err_t - ESP_OK if the file was created
+     */
+    esp_err_t open(const char* path, size_t preallocate = 0);
+
+    /**
+     * @brief Append data to the file
+     *
+     * @param data - The bytes to append
+     * @param length - Number of bytes to append
+     * @return esp_err_t - ESP_OK if the data was buffered or written
+     */
+    esp_err_t write(const void* data, size_t length);
+
+    /**
+     * @brief Append zeros up to the next sector boundary
+     *
+     * @return esp_err_t - ESP_OK if the padding was buffered or written
+     */
+    esp_err_t pad_to_sector();
+
+    /**
+     * @brief Overwrite an already written sector
+     *
+     * @param sector - Index of the sector from the start of the file
+     * @param data - SD_SECTOR_SIZE bytes to write
+     * @return esp_err_t - ESP_OK if the sector was written
+     */
+    esp_err_t rewrite_sector(uint32_t sector, const void* data);
+
+    /**
+     * @brief Flush the buffer, trim unused preallocated space and close the file
+     *
+     * @return esp_err_t - ESP_OK if everything reached the filesystem
+     */
+    esp_err_t close();
+
+    /// @brief True while a file is open
+    bool is_open() const { return fd_ >= 0; }
+
+    /// @brief Logical size of the file written so far
+    uint32_t position() const { return flushed_ + used_; }
+
+    /// @brief Counters since the file was opened
+    const Stats& stats() const { return stats_; }
+
+    /// @brief Bytes handed to the filesystem per payload byte, in 8.8 fixed point
+    uint32_t write_amplification() const {
+        return stats_.payload_bytes ? (stats_.device_bytes << 8) / stats_.payload_bytes : 0;
+    }
+
+private:
+    esp_err_t write_out(uint32_t offset, const uint8_t* data, size_t length);
+    esp_err_t flush_sectors();
+
+    static constexpr size_t BUFFER_SIZE = SD_ALLOCATION_UNIT;
+
+    int fd_ = -1;
+    uint8_t* buffer_ = nullptr;
+    size_t used_ = 0;
+    uint32_t flushed_ = 0;
+    Stats stats_ = {};
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief Binary mask storing one bit per pixel
+ *
+ * Each row is padded to whole 32 bit words (the ESP32's native width) and
+ * the padding bits are always kept clear, so counts can popcount whole
+ * words. A 96x96 mask takes 1152 bytes instead of the 9216 of a CV_8UC1 mask.
+ *
+ * @tparam W - Width of the mask in pixels
+ * @tparam H - Height of the mask in pixels
+ */
+template <int W, int H>
+class BitMask {
+public:
+    static_assert(W > 0 && H > 0, "BitMask needs a non-zero size");
+
+    /// @brief 32 bit words per row
+    static constexpr int WORDS_PER_ROW = (W + 31) / 32;
+
+    static constexpr int width() { return W; }
+    static constexpr int height() { return H; }
+
+    /// @brief Clear every pixel
+    void clear() { memset(words_, 0, sizeof(words_)); }
+
+    /// @brief Set the pixel at column x, row y
+    void set(int x, int y) { words_[y][x >> 5] |= 1u << (x & 31); }
+
+    /// @brief Clear the pixel at column x, row y
+    void reset(int x, int y) { words_[y][x >> 5] &= ~(1u << (x & 31)); }
+
+    /// @brief True if the pixel at column x, row y is set
+    bool get(int x, int y) const { return (words_[y][x >> 5] >> (x & 31)) & 1; }
+
+    /// @brief The words of a row, bit i of word w is column 32 * w + i
+    uint32_t* row(int y) { return words_[y]; }
+    const uint32_t* row(int y) const { return words_[y]; }
+
+    /// @brief Number of set pixels in the whole mask
+    int count() const {
+        int total = 0;
+        for (int y = 0; y < H; y++) {
+            for (int w = 0; w < WORDS_PER_ROW; w++) {
+                total += __builtin_popcount(words_[y][w]);
+            }
+        }
+        return total;
+    }
+
+    /**
+     * @brief Number of set pixels in columns [x0, x1) of rows [y0, y1)
+     *
+     * The box is clipped to the mask.
+     */
+    int count(int x0, int y0, int x1, int y1) const {
+        x0 = x0 < 0 ? 0 : x0;
+        y0 = y0 < 0 ? 0 : y0;
+        x1 = x1 > W ? W : x1;
+        y1 = y1 > H ? H : y1;
+        if (x1 <= x0 || y1 <= y0) {
+            return 0;
+        }
+
+        // Masks selecting the box's columns in its first and last word
+        const int first = x0 >> 5;
+        const int last = (x1 - 1) >> 5;
+        const uint32_t first_mask = ~0u << (x0 & 31);
+        const uint32_t last_mask = ~0u >> (31 - ((x1 - 1) & 31));
+
+        int total = 0;
+        for (int y = y0; y < y1; y++) {
+            const uint32_t* words = words_[y];
+            if (first == last) {
+                total += __builtin_popcount(words[first] & first_mask & last_mask);
+                continue;
+            }
+            total += __builtin_popcount(words[first] & first_mask);
+            for (int w = first + 1; w < last; w++) {
+                total += __builtin_popcount(words[w]);
+            }
+            total += __builtin_popcount(words[last] & last_mask);
+        }
+        return total;
+    }
+
+    /// @brief Keep only pixels that are also set in another mask
+    BitMask& operator&=(const BitMask& other) {
+        for (int y = 0; y < H; y++) {
+            for (int w = 0; w < WORDS_PER_ROW; w++) {
+                words_[y][w] &= other.words_[y][w];
+            }
+        }
+        return *this;
+    }
+
+    /// @brief Add the pixels set in another mask
+    BitMask& operator|=(const BitMask& other) {
+        for (int y = 0; y < H; y++) {
+            for (int w = 0; w < WORDS_PER_ROW; w++) {
+                words_[y][w] |= other.words_[y][w];
+            }
+        }
+        return *this;
+    }
+
+    /// @brief Flip every pixel, leaving the row padding clear
+    void invert() {
+        for (int y = 0; y < H; y++) {
+            for (int w = 0; w < WORDS_PER_ROW; w++) {
+                words_[y][w] = ~words_[y][w];
+            }
+            words_[y][WORDS_PER_ROW - 1] &= LAST_WORD_MASK;
+        }
+    }
+
+    /**
+     * @brief Number of set pixels in every row
+     *
+     * @param out - Receives H counts
+     */
+    void row_projection(uint16_t* out) const {
+        for (int y = 0; y < H; y++) {
+            int total = 0;
+            for (int w = 0; w < WORDS_PER_ROW; w++) {
+                total += __builtin_popcount(words_[y][w]);
+            }
+            out[y] = total;
+        }
+    }
+
+    /**
+     * @brief Number of set pixels in every column
+     *
+     * @param out - Receives W counts
+     */
+    void column_projection(uint16_t* out) const {
+        memset(out, 0, W * sizeof(uint16_t));
+        for_each_set([out](int x, int) { out[x]++; });
+    }
+
+    /**
+     * @brief Call a function for every set pixel, row by row from the top left
+     *
+     * @param fn - Called as fn(x, y)
+     */
+    template <typename Fn>
+    void for_each_set(Fn fn) const {
+        for (int y = 0; y < H; y++) {
+            for (int w = 0; w < WORDS_PER_ROW; w++) {
+                uint32_t bits = words_[y][w];
+                while (bits) {
+                    fn(32 * w + __builtin_ctz(bits), y);
+                    bits &= bits - 1;
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr uint32_t LAST_WORD_MASK = (W % 32) ? (1u << (W % 32)) - 1 : ~0u;
+
+    uint32_t words_[H][WORDS_PER_ROW];
+};
@@ -1,6 +1,12 @@
 #pragma once
 
+#ifndef CAMERA_NO_OPENCV
 #include "opencv2.hpp"
+#endif
+#include "container.hpp"
+#include "vision.hpp"
+#include <cstddef>
+#include <cstdint>
 #include <esp_err.h>
 #include "esp_camera.h"
 
@@ -13,11 +19,121 @@ namespace Camera {
     /// @brief Tag used in ESP debug logs
     static const char* TAG = "CAMERA";
 
+    /**
+     * @brief Scoped ownership of a frame buffer borrowed from the camera driver
+     *
+     * The buffer is handed back with esp_camera_fb_return() when the handle is
+     * destroyed or reset, so the pixels can be read in place without copying
+     * them out of the driver's PSRAM buffer first. Handles are move-only.
+     */
+    class FrameHandle {
+    public:
+        FrameHandle() = default;
+        explicit FrameHandle(camera_fb_t* fb) : fb_(fb) {}
+        ~FrameHandle() { reset(); }
+
+        FrameHandle(const FrameHandle&) = delete;
+        FrameHandle& operator=(const FrameHandle&) = delete;
+
+        FrameHandle(FrameHandle&& other) noexcept : fb_(other.release()) {}
+        FrameHandle& operator=(FrameHandle&& other) noexcept {
+            if (this != &other) {
+                reset(other.release());
+            }
+            return *this;
+        }
+
+        /**
+         * @brief Return the held buffer to the driver and take ownership of another
+         *
+         * @param fb - The new buffer to hold, or nullptr to hold nothing
+         */
+        void reset(camera_fb_t* fb = nullptr);
+
+        /**
+         * @brief Give up ownership of the held buffer without returning it
+         *
+         * @return camera_fb_t* - The buffer, which the caller must now return
+         */
+        camera_fb_t* release() {
+            camera_fb_t* fb = fb_;
+            fb_ = nullptr;
+            return fb;
+        }
+
+        /// @brief True if the handle currently holds a frame
+        explicit operator bool() const { return fb_ != nullptr; }
+
+        /// @brief The underlying driver frame buffer
+        camera_fb_t* get() const { return fb_; }
+
+        /// @brief Raw pixel bytes of the frame
+        const uint8_t* data() const { return fb_->buf; }
+
+        /// @brief Length of the frame in bytes
+        size_t size() const { return fb_->len; }
+
+        /// @brief Width of the frame in pixels
+        int width() const { return static_cast<int>(fb_->width); }
+
+        /// @brief Height of the frame in pixels
+        int height() const { return static_cast<int>(fb_->height); }
+
+        /// @brief Pixel format the driver delivered the frame in
+        pixformat_t format() const { return fb_->format; }
+
+#ifndef CAMERA_NO_OPENCV
+        /**
+         * @brief View the frame as an OpenCV matrix without copying it
+         *
+         * The matrix is a non-owning CV_8UC2 header over the driver buffer and
+         * must not be used after the handle is reset or destroyed.
+         *
+         * @return cv::Mat - A header pointing at the RGB565 pixels
+         */
+        cv::Mat mat() const {
+            return cv::Mat(height(), width(), CV_8UC2, fb_->buf);
+        }
+#endif
+
+    private:
+        camera_fb_t* fb_ = nullptr;
+    };
+
     /**
      * @brief Configure the camera
      * 
+     * @param fb_count - Number of frame buffers for the driver. With more than
+     *                   one, the driver runs in grab-latest mode so it keeps
+     *                   capturing while earlier frames are being processed.
      */
-    void config_cam();
+    void config_cam(size_t fb_count = 1);
+
+    /**
+     * @brief Keep only the rows from first_row down of every captured frame
+     *
+     * The driver rejects RGB565 frames that are not the full configured size,
+     * so the band is taken from the driver buffer instead of shrinking the
+     * sensor window: vision_frame() points past the rows above it, and
+     * capture_and_append() and capture_and_queue() store only the band,
+     * recording its first row in the frame header. The per-file captures
+     * always store whole frames, as IMAGE{n}.BIN has no header.
+     * Vision::FIRST_USED_ROW keeps everything the detectors use.
+     *
+     * @param first_row - First row to keep, 0 for whole frames
+     */
+    void set_row_window(int first_row);
+
+    /// @brief First row kept by set_row_window(), 0 for whole frames
+    int row_window();
+
+    /**
+     * @brief View the rows of a frame kept by the row window, without copying
+     *
+     * @param frame - A captured RGB565 frame
+     * @return Vision::Frame - The band of rows, in full frame coordinates
+     */
+    Vision::Frame vision_frame(const FrameHandle& frame);
 
     /**
      * @brief Get a frame from the camera and immediately throw it away
@@ -27,6 +143,7 @@ namespace Camera {
      */
     esp_err_t get_frame();
 
+#ifndef CAMERA_NO_OPENCV
     /**
      * @brief Get a frame and store it in an opencv matrix
      *
@@ -35,18 +152,55 @@ namespace Camera {
      * @return esp_err_t - ESP_OK if the image was successfully stored in the matrix
      */
     esp_err_t get_frame(cv::Mat& image);
+#endif
+
+    /**
+     * @brief Get a frame and hold it in place in the driver's buffer
+     *
+     * Unlike the cv::Mat overload this does not allocate or copy; the frame is
+     * returned to the driver when the handle goes out of scope.
+     *
+     * @overload
+     * @param frame - The handle to store the RGB565 frame in
+     * @return esp_err_t - ESP_OK if a RGB565 frame was captured
+     */
+    esp_err_t get_frame(FrameHandle& frame);
 
+#ifndef CAMERA_NO_OPENCV
     /**
      * @brief Capture and save an opencv matrix image to the sd card
      * 
      * @return esp_err_t - ESP_OK if the image was successfully saved
      */
     esp_err_t capture_and_save_image();
+#endif
 
     /**
      * @brief Capture and save a raw image to the sd card without OpenCV
+     *
+     * Always saves the whole RGB565 frame, ignoring set_row_window(), so the
+     * file stays readable by openimages.py and the host dataset loader.
      * 
      * @return esp_err_t - ESP_OK if the image was successfully saved
      */
     esp_err_t capture_and_save_image_nocv();
+
+    /**
+     * @brief Capture a frame and append it to an open container file
+     * 
+     * @param writer - The container to append the frame to
+     * @return esp_err_t - ESP_OK if the frame was appended
+     */
+    esp_err_t capture_and_append(Container::Writer& writer);
+
+    /**
+     * @brief Capture a frame and queue it on the background writer
+     * 
+     * The frame is copied into a staging slot so the camera buffer goes back
+     * to the driver without waiting for the SD card. WriteBehind::start must
+     * have been called first.
+     * 
+     * @return esp_err_t - ESP_OK if the frame was queued
+     */
+    esp_err_t capture_and_queue();
 }
\ No newline at end of file
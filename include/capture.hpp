@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <esp_err.h>
+#include "camera.hpp"
+#include "freertos/FreeRTOS.h"
+
+/**
+ * @brief Continuous capture on a dedicated task
+ *
+ * A capture task pinned to one core keeps pulling frames from the driver and
+ * publishes the newest one through a single lock-free slot, so the sensor
+ * keeps filling buffers while the consumer is busy processing the previous
+ * frame. A frame that is replaced before the consumer takes it goes straight
+ * back to the driver.
+ */
+namespace Capture {
+
+    /// @brief Tag used in ESP debug logs
+    static const char* TAG = "CAPTURE";
+
+    /// @brief Frame buffers to give the driver: the published one, one held by the consumer and one being filled
+    constexpr size_t FB_COUNT = 3;
+
+    /// @brief Counters describing how the capture task is keeping up
+    struct Stats {
+        uint32_t captured;      ///< Frames pulled from the driver
+        uint32_t overwritten;   ///< Frames replaced by a newer one before the consumer took them
+        uint32_t failed;        ///< Driver captures that returned no frame
+    };
+
+    /**
+     * @brief Start the capture task
+     *
+     * The camera must already be configured with Capture::FB_COUNT buffers.
+     *
+     * @param core - The core to pin the capture task to
+     * @param priority - FreeRTOS priority of the capture task
+     * @return esp_err_t - ESP_OK if the task was started
+     */
+    esp_err_t start(int core = 0, UBaseType_t priority = 5);
+
+    /**
+     * @brief Stop the capture task and hand all queued frames back to the driver
+     */
+    void stop();
+
+    /**
+     * @brief Take the newest captured frame
+     *
+     * @param frame - The handle to store the frame in
+     * @param timeout - How long to wait for a frame if none is queued
+     * @return esp_err_t - ESP_OK if a frame was taken, ESP_ERR_TIMEOUT otherwise
+     */
+    esp_err_t take_latest(Camera::FrameHandle& frame, TickType_t timeout = portMAX_DELAY);
+
+    /**
+     * @brief Get a snapshot of the capture counters
+     *
+     * @return Stats - The counters since the task was started
+     */
+    Stats get_stats();
+}
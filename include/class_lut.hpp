@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <esp_err.h>
+#include "vision.hpp"
+
+/**
+ * @brief Lookup table from every RGB565 code to its Vision::ClassBits
+ *
+ * RGB565 only has 65,536 colours, so all colour predicates can be evaluated
+ * ahead of time. The table is generated at compile time into flash and can
+ * be copied into internal RAM or PSRAM, trading memory for lookup latency.
+ */
+namespace ClassLut {
+
+    /// @brief Tag used in ESP debug logs
+    static const char* TAG = "CLASS_LUT";
+
+    /// @brief Number of entries, one per RGB565 code
+    constexpr size_t SIZE = 1 << 16;
+
+    /// @brief Where the table being used lives
+    enum class Placement {
+        Flash,          ///< The compile-time table in .rodata, read through the flash cache
+        InternalRam,    ///< A copy in internal DRAM, fastest but uses 64 KB of it
+        Psram,          ///< A copy in external PSRAM, read through the PSRAM cache
+    };
+
+    /// @brief The class bits of every RGB565 code
+    struct Table {
+        uint8_t bits[SIZE];
+    };
+
+    /// @brief Build the table by running Vision::classify on every code
+    constexpr Table generate()
+    {
+        Table table = {};
+        for (size_t code = 0; code < SIZE; code++) {
+            table.bits[code] = Vision::classify(static_cast<uint16_t>(code));
+        }
+        return table;
+    }
+
+    /**
+     * @brief Select where the table is read from, copying it there if needed
+     *
+     * @param placement - Where the table should live
+     * @return esp_err_t - ESP_OK if the table is in place, ESP_ERR_NO_MEM if
+     *                     the copy could not be allocated (the flash table stays in use)
+     */
+    esp_err_t init(Placement placement = Placement::Flash);
+
+    /// @brief Where the table currently in use lives
+    Placement placement();
+
+    /// @brief The table currently in use, indexed by RGB565 code
+    const uint8_t* table();
+
+    /**
+     * @brief Measure lookup latency of every placement against Vision::classify and log it
+     *
+     * Restores the current placement afterwards.
+     */
+    void log_report();
+}
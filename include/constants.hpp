@@ -21,7 +21,13 @@
 #define CAM_PIN_PCLK    22
 #define FLASH_GPIO_PIN  4
 
+// The host simulator points this at a local directory
+#ifndef MOUNT_POINT
 #define MOUNT_POINT "/sdcard"
+#endif
 #define FILE_PREFIX "IMAGE"
 #define FILE_EXTENSION ".BIN"
-#define CONFIG_FILE "/sdcard/config.txt"
\ No newline at end of file
+#define CONFIG_FILE MOUNT_POINT "/config.txt"
+
+#define SD_SECTOR_SIZE 4096
+#define SD_ALLOCATION_UNIT (16 * 1024)
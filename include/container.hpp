@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <esp_err.h>
+#include "aligned_writer.hpp"
+
+/**
+ * @brief Append-only container holding many frames in a single file
+ *
+ * Writing one small file per frame makes every capture pay for a FAT
+ * directory lookup that gets slower as the card fills up. A container keeps
+ * a whole capture run in one (optionally preallocated) file instead.
+ *
+ * Layout, all fields little-endian:
+ *  - FileHeader at offset 0, padded to `header_size` bytes (one SD_SECTOR_SIZE sector)
+ *  - For each frame a FrameHeader followed by `length` bytes of pixels and
+ *    `padding` bytes of filler
+ *  - On close, an IndexHeader followed by one uint32_t offset per frame
+ *
+ * The file header is patched on close with the frame count and index offset.
+ * A file that was never closed (e.g. power loss) has no index and is read by
+ * walking the frame headers until the first one that is not valid.
+ */
+namespace Container {
+
+    /// @brief Tag used in ESP debug logs
+    static const char* TAG = "CONTAINER";
+
+    constexpr char FILE_MAGIC[8] = {'E', 'S', 'P', 'C', 'A', 'M', 'F', 'C'};
+    constexpr uint32_t FORMAT_VERSION = 1;
+    constexpr uint32_t FRAME_MAGIC = 0x4D524643;  ///< "CFRM"
+    constexpr uint32_t INDEX_MAGIC = 0x58444943;  ///< "CIDX"
+
+    /// @brief Header at the start of every container file
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t header_size;   ///< SD_SECTOR_SIZE, offset of the first frame
+        uint32_t frame_count;   ///< Written on close, 0 while the file is open
+        uint32_t index_offset;  ///< Written on close, 0 while the file is open
+        uint32_t reserved[2];
+    };
+    static_assert(sizeof(FileHeader) == 32, "FileHeader layout changed");
+
+    /// @brief Header in front of every frame's pixel data
+    struct FrameHeader {
+        uint32_t magic;
+        uint32_t frame_id;
+        uint64_t timestamp_us;
+        uint16_t format;        ///< pixformat_t of the frame
+        uint16_t width;
+        uint16_t height;        ///< Rows stored, the bottom rows of the frame
+        uint16_t first_row;     ///< Row of the full frame the stored rows start at, 0 for whole frames
+        uint32_t length;        ///< Bytes of pixel data following the header
+        uint32_t padding;       ///< Bytes of filler after the pixel data
+    };
+    static_assert(sizeof(FrameHeader) == 32, "FrameHeader layout changed");
+
+    /// @brief Header of the trailing frame index
+    struct IndexHeader {
+        uint32_t magic;
+        uint32_t count;         ///< Number of uint32_t frame offsets that follow
+    };
+    static_assert(sizeof(IndexHeader) == 8, "IndexHeader layout changed");
+
+    /**
+     * @brief Appends frames to a container file
+     *
+     * The file header takes a whole SD sector, so it can be patched on close
+     * without a read-modify-write, and all data goes through an AlignedWriter.
+     */
+    class Writer {
+    public:
+        Writer() = default;
+        ~Writer() { close(); }
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        /**
+         * @brief Create a new container file, replacing any existing one
+         *
+         * @param path - Where to create the file
+         * @param preallocate - Bytes to reserve as one contiguous extent up front, 0 for none
+         * @param pad_frames - Start every frame on a sector boundary instead of packing them
+         * @return esp_err_t - ESP_OK if the file was created
+         */
+        esp_err_t open(const char* path, size_t preallocate = 0, bool pad_frames = false);
+
+        /**
+         * @brief Append a frame to the container
+         *
+         * @param data - The frame's pixel data
+         * @param length - Length of the pixel data in bytes
+         * @param width - Width of the frame in pixels
+         * @param height - Rows of the frame in data
+         * @param format - Pixel format of the frame
+         * @param timestamp_us - Capture time of the frame in microseconds
+         * @param first_row - Row of the full frame that data starts at
+         * @return esp_err_t - ESP_OK if the frame was written
+         */
+        esp_err_t append(const uint8_t* data, uint32_t length, uint16_t width, uint16_t height,
+                         uint16_t format, uint64_t timestamp_us, uint16_t first_row = 0);
+
+        /**
+         * @brief Write the index, patch the file header and close the file
+         *
+         * @return esp_err_t - ESP_OK if the container was finalised
+         */
+        esp_err_t close();
+
+        /// @brief True while a file is open for writing
+        bool is_open() const { return file_.is_open(); }
+
+        /// @brief Number of frames appended so far
+        uint32_t frame_count() const { return static_cast<uint32_t>(offsets_.size()); }
+
+        /// @brief Write amplification counters of the underlying file
+        const AlignedWriter::Stats& storage_stats() const { return file_.stats(); }
+
+    private:
+        AlignedWriter file_;
+        bool pad_frames_ = false;
+        std::vector<uint32_t> offsets_;
+    };
+
+    /**
+     * @brief Reads frames back from a container file, in order or by index
+     */
+    class Reader {
+    public:
+        Reader() = default;
+        ~Reader() { close(); }
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        /**
+         * @brief Open a container and load or rebuild its frame index
+         *
+         * @param path - The container file
+         * @return esp_err_t - ESP_OK if the file is a readable container
+         */
+        esp_err_t open(const char* path);
+
+        /// @brief Close the file
+        void close();
+
+        /// @brief Number of frames in the container
+        size_t frame_count() const { return offsets_.size(); }
+
+        /// @brief True if the index was rebuilt because the file was never closed
+        bool recovered() const { return recovered_; }
+
+        /**
+         * @brief Read a frame by its position in the container
+         *
+         * @param index - Position of the frame, starting at 0
+         * @param header - Receives the frame header
+         * @param data - Receives the pixel data, resized to fit
+         * @return esp_err_t - ESP_OK if the frame was read
+         */
+        esp_err_t read_frame(size_t index, FrameHeader& header, std::vector<uint8_t>& data);
+
+        /**
+         * @brief Read the next frame when streaming through the container
+         *
+         * @param header - Receives the frame header
+         * @param data - Receives the pixel data, resized to fit
+         * @return esp_err_t - ESP_OK if a frame was read, ESP_ERR_NOT_FOUND at the end
+         */
+        esp_err_t next(FrameHeader& header, std::vector<uint8_t>& data);
+
+        /// @brief Restart streaming from the first frame
+        void rewind() { cursor_ = 0; }
+
+    private:
+        esp_err_t load_index(const FileHeader& file_header);
+        void scan_frames(uint32_t start);
+
+        FILE* file_ = nullptr;
+        std::vector<uint32_t> offsets_;
+        size_t cursor_ = 0;
+        bool recovered_ = false;
+    };
+}
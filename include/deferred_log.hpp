@@ -0,0 +1,236 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <esp_err.h>
+#include <esp_log.h>
+#include "freertos/FreeRTOS.h"
+
+/**
+ * @brief Binary logging that keeps printf and the UART off the frame path
+ *
+ * DLOGI(tag, format, ...) does not format anything. It stores the address of
+ * the format string and tag, a timestamp and the raw arguments in a fixed-size
+ * record, and pushes it into the ring of the current core. A low-priority task
+ * drains the rings into a binary log file, and host/decode_log.py turns the
+ * file back into text by reading the format strings out of the firmware ELF.
+ *
+ * Until start() is called, or after stop(), the DLOG macros fall back to the
+ * matching ESP_LOG macro so nothing is lost.
+ */
+namespace DeferredLog {
+
+    /// @brief Tag used in ESP debug logs
+    static const char* TAG = "DEFERRED_LOG";
+
+    /// @brief Records each core's ring holds before new ones are dropped
+    constexpr size_t RING_SIZE = 64;
+
+    /// @brief Space for the encoded arguments of one record, in bytes
+    constexpr size_t ARG_BYTES = 48;
+
+    /// @brief First bytes of a log file
+    constexpr char MAGIC[4] = {'D', 'L', 'O', 'G'};
+
+    /// @brief Version of the log file layout
+    constexpr uint32_t VERSION = 1;
+
+    /**
+     * @brief Type code written before each argument
+     *
+     * Integers are widened to 32 or 64 bits, floats to double, and strings are
+     * copied with a one byte length since the buffer they point at may be gone
+     * by the time the record is written out.
+     */
+    enum ArgType : uint8_t {
+        ARG_INT32 = 'i',
+        ARG_UINT32 = 'u',
+        ARG_INT64 = 'I',
+        ARG_UINT64 = 'U',
+        ARG_DOUBLE = 'f',
+        ARG_STRING = 's',
+        ARG_POINTER = 'p',
+    };
+
+    /// @brief One log call, as stored in the ring
+    struct Record {
+        const char* format;         ///< The format string, which identifies the call site
+        const char* tag;
+        uint32_t timestamp_ms;      ///< As printed by ESP_LOG
+        uint8_t level;              ///< An esp_log_level_t
+        uint8_t length;             ///< Bytes used in args
+        uint8_t args[ARG_BYTES];    ///< ArgType codes, each followed by its value
+    };
+
+    /// @brief Configuration of the flush task
+    struct Config {
+        int core = 0;                       ///< Core to pin the flush task to
+        UBaseType_t priority = 1;           ///< FreeRTOS priority of the flush task, just above idle
+        uint32_t stack_size = 4096;         ///< Stack of the flush task in bytes, enough for fwrite() to the card
+        uint32_t flush_interval_ms = 50;    ///< How often the rings are drained
+    };
+
+    /// @brief Counters describing how the flush task is keeping up
+    struct Stats {
+        uint32_t logged;    ///< Records pushed into a ring
+        uint32_t dropped;   ///< Records lost because their ring was full
+        uint32_t written;   ///< Records written to the log file
+    };
+
+    /**
+     * @brief Open the log file and start the flush task
+     *
+     * @param path - Log file to create, on a mounted filesystem
+     * @param config - Placement and cadence of the flush task
+     * @return esp_err_t - ESP_OK if the DLOG macros now log to the file
+     */
+    esp_err_t start(const char* path, const Config& config = Config());
+
+    /**
+     * @brief Write out every queued record, then stop the flush task and close the file
+     */
+    void stop();
+
+    /**
+     * @brief Wait until every record logged so far is in the file
+     *
+     * @param timeout - How long to wait for the flush task
+     * @return esp_err_t - ESP_OK once flushed, ESP_ERR_TIMEOUT or ESP_ERR_INVALID_STATE otherwise
+     */
+    esp_err_t flush(TickType_t timeout = portMAX_DELAY);
+
+    /// @brief True between start() and stop()
+    bool running();
+
+    /**
+     * @brief Get a snapshot of the logger counters
+     *
+     * @return Stats - The counters since start()
+     */
+    Stats get_stats();
+
+    /**
+     * @brief Push a record into the current core's ring, see DLOGI
+     *
+     * @param record - The encoded log call
+     */
+    void push(const Record& record);
+
+    /// @brief Cost of one log call, from log_benchmark()
+    struct Benchmark {
+        uint32_t esp_log_ns;    ///< ESP_LOGI, formatted and printed on the console
+        uint32_t deferred_ns;   ///< DLOGI, queued for the flush task
+    };
+
+    /**
+     * @brief Time ESP_LOGI against DLOGI for the same message and log the cost per call
+     *
+     * The logger must be running. The DLOGI calls are made in bursts that fit
+     * in the ring, with an untimed flush between bursts.
+     *
+     * @param calls - Calls to time of each kind
+     * @return Benchmark - Nanoseconds per call, all zero if the logger is not running
+     */
+    Benchmark log_benchmark(int calls = 256);
+
+    /// @brief Appends encoded arguments to a record, dropping those that do not fit
+    class ArgWriter {
+    public:
+        explicit ArgWriter(Record& record) : record_(record) {}
+
+        template <typename T>
+        void put(T value) {
+            using Plain = std::remove_cv_t<std::remove_pointer_t<T>>;
+            if constexpr (std::is_pointer_v<T> && std::is_same_v<Plain, char>) {
+                put_string(value);
+            } else if constexpr (std::is_pointer_v<T>) {
+                put_value(ARG_POINTER, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value)));
+            } else if constexpr (std::is_floating_point_v<T>) {
+                put_value(ARG_DOUBLE, static_cast<double>(value));
+            } else if constexpr (std::is_enum_v<T>) {
+                put(static_cast<std::underlying_type_t<T>>(value));
+            } else if constexpr (sizeof(T) <= 4) {
+                if constexpr (std::is_signed_v<T>) {
+                    put_value(ARG_INT32, static_cast<int32_t>(value));
+                } else {
+                    put_value(ARG_UINT32, static_cast<uint32_t>(value));
+                }
+            } else if constexpr (std::is_signed_v<T>) {
+                put_value(ARG_INT64, static_cast<int64_t>(value));
+            } else {
+                put_value(ARG_UINT64, static_cast<uint64_t>(value));
+            }
+        }
+
+    private:
+        template <typename V>
+        void put_value(ArgType type, V value) {
+            if (full_ || record_.length + 1 + sizeof(value) > ARG_BYTES) {
+                full_ = true;
+                return;
+            }
+            record_.args[record_.length] = type;
+            memcpy(&record_.args[record_.length + 1], &value, sizeof(value));
+            record_.length += 1 + sizeof(value);
+        }
+
+        // Strings are cut short to fit rather than dropped
+        void put_string(const char* value) {
+            if (full_ || static_cast<size_t>(record_.length) + 2 > ARG_BYTES) {
+                full_ = true;
+                return;
+            }
+            const size_t room = ARG_BYTES - record_.length - 2;
+            size_t length = 0;
+            while (value && length < room && value[length]) {
+                length++;
+            }
+            record_.args[record_.length] = ARG_STRING;
+            record_.args[record_.length + 1] = static_cast<uint8_t>(length);
+            if (length) {
+                memcpy(&record_.args[record_.length + 2], value, length);
+            }
+            record_.length += 2 + length;
+        }
+
+        Record& record_;
+        bool full_ = false;
+    };
+
+    /**
+     * @brief Encode a log call into the current core's ring, see DLOGI
+     *
+     * @param level - Level the decoder prints the line at
+     * @param tag - Tag of the line, a string literal
+     * @param format - printf format of the line, a string literal
+     * @param args - Arguments of the format
+     */
+    template <typename... Args>
+    void log(esp_log_level_t level, const char* tag, const char* format, Args... args) {
+        Record record;
+        record.format = format;
+        record.tag = tag;
+        record.timestamp_ms = esp_log_timestamp();
+        record.level = static_cast<uint8_t>(level);
+        record.length = 0;
+        ArgWriter writer(record);
+        (writer.put(args), ...);
+        push(record);
+    }
+}
+
+// The format and tag must be string literals: only their addresses are logged
+
+#define DLOG_LEVEL(level, esp_log, tag, format, ...) do {                       \
+        if (DeferredLog::running()) {                                           \
+            DeferredLog::log(level, tag, format, ##__VA_ARGS__);                \
+        } else {                                                                \
+            esp_log(tag, format, ##__VA_ARGS__);                                \
+        }                                                                       \
+    } while (0)
+
+#define DLOGE(tag, format, ...) DLOG_LEVEL(ESP_LOG_ERROR, ESP_LOGE, tag, format, ##__VA_ARGS__)
+#define DLOGW(tag, format, ...) DLOG_LEVEL(ESP_LOG_WARN, ESP_LOGW, tag, format, ##__VA_ARGS__)
+#define DLOGI(tag, format, ...) DLOG_LEVEL(ESP_LOG_INFO, ESP_LOGI, tag, format, ##__VA_ARGS__)
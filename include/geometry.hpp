@@ -0,0 +1,32 @@
+#pragma once
+
+namespace Vision {
+
+    /// @brief A pixel position
+    struct Point {
+        int x;
+        int y;
+    };
+
+    /// @brief Rectangle covering columns [x0, x1) and rows [y0, y1), like a numpy slice
+    struct Rect {
+        int x0;
+        int y0;
+        int x1;
+        int y1;
+
+        constexpr int area() const { return (x1 - x0) * (y1 - y0); }
+
+        /// @brief The rectangle grown by margin pixels on every side
+        constexpr Rect dilated(int margin) const { return {x0 - margin, y0 - margin, x1 + margin, y1 + margin}; }
+
+        /// @brief The part of the rectangle inside bounds, with zero area if there is none
+        constexpr Rect clipped(const Rect& bounds) const {
+            Rect r = {x0 > bounds.x0 ? x0 : bounds.x0, y0 > bounds.y0 ? y0 : bounds.y0,
+                      x1 < bounds.x1 ? x1 : bounds.x1, y1 < bounds.y1 ? y1 : bounds.y1};
+            r.x1 = r.x1 < r.x0 ? r.x0 : r.x1;
+            r.y1 = r.y1 < r.y0 ? r.y0 : r.y1;
+            return r;
+        }
+    };
+}
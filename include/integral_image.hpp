@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include "bit_mask.hpp"
+
+/**
+ * @brief Summed-area table of a binary mask
+ *
+ * Entry (x, y) holds the number of set pixels above and to the left of it,
+ * so the count of any rectangle costs four lookups however large it is.
+ * 16 bit entries are enough for masks of up to 65,535 pixels.
+ *
+ * @tparam W - Width of the mask in pixels
+ * @tparam H - Height of the mask in pixels
+ */
+template <int W, int H>
+class IntegralImage {
+public:
+    static_assert(W * H <= UINT16_MAX, "Mask too large for 16 bit sums");
+
+    /**
+     * @brief Add the next row of the mask, rows must be added top to bottom
+     *
+     * @param y - Index of the row
+     * @param words - The row's bits, packed as in BitMask
+     */
+    void add_row(int y, const uint32_t* words) {
+        const uint16_t* above = sums_[y];
+        uint16_t* sums = sums_[y + 1];
+        uint16_t run = 0;
+        sums[0] = 0;
+        for (int x = 0; x < W; x++) {
+            run += (words[x >> 5] >> (x & 31)) & 1;
+            sums[x + 1] = above[x + 1] + run;
+        }
+    }
+
+    /// @brief Build the table from a whole mask
+    void build(const BitMask<W, H>& mask) {
+        for (int y = 0; y < H; y++) {
+            add_row(y, mask.row(y));
+        }
+    }
+
+    /**
+     * @brief Number of set pixels in columns [x0, x1) of rows [y0, y1)
+     *
+     * The box is clipped to the mask.
+     */
+    int count(int x0, int y0, int x1, int y1) const {
+        x0 = x0 < 0 ? 0 : x0;
+        y0 = y0 < 0 ? 0 : y0;
+        x1 = x1 > W ? W : x1;
+        y1 = y1 > H ? H : y1;
+        if (x1 <= x0 || y1 <= y0) {
+            return 0;
+        }
+        return sums_[y1][x1] - sums_[y0][x1] - sums_[y1][x0] + sums_[y0][x0];
+    }
+
+private:
+    // Row and column 0 stay zero so count() needs no edge cases
+    uint16_t sums_[H + 1][W + 1] = {};
+};
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <cstdint>
+#include "bit_mask.hpp"
+#include "geometry.hpp"
+#include "moments.hpp"
+
+namespace Vision {
+
+    /// @brief Statistics of one 8-connected blob of set pixels
+    struct Blob {
+        int area;           ///< Number of pixels
+        Rect bounds;        ///< Bounding box
+        Point centroid;     ///< Mean pixel position, rounded down
+        Point top_left;     ///< Leftmost pixel of the top row
+        Point bottom_left;  ///< Leftmost pixel of the bottom row
+        Moments moments;    ///< Raw moments up to second order, for fit_line()
+    };
+
+    /**
+     * @brief Run-length based connected components labeling over a BitMask
+     *
+     * Each row is split into runs of set pixels, runs touching a run in the
+     * row above (8-connectivity) are merged with union-find, and a second
+     * pass over the runs accumulates per-blob statistics, including the
+     * second order moments, in closed form per run. All storage is a
+     * fixed part of the object sized for the worst case mask, so labeling
+     * never allocates. At most MAX_BLOBS blobs are reported, in raster
+     * order; overflowed() says whether any were left out. The largest blob
+     * is always reported, taking the last slot if it would not otherwise
+     * have got one.
+     *
+     * @tparam W - Width of the mask in pixels
+     * @tparam H - Height of the mask in pixels
+     */
+    template <int W, int H>
+    class Labeler {
+    public:
+        /// @brief Most runs a mask can have: alternating pixels in every row
+        static constexpr int MAX_RUNS = H * ((W + 1) / 2);
+
+        /// @brief Most blobs that are reported
+        static constexpr int MAX_BLOBS = 256;
+
+        static_assert(MAX_RUNS <= UINT16_MAX, "Mask too large for 16 bit run indices");
+        static_assert(W * H <= UINT16_MAX, "Mask too large for 16 bit blob areas");
+
+        /**
+         * @brief Label the blobs of a mask
+         *
+         * @param mask - The mask to label
+         * @param first_row - Rows above this are ignored
+         * @param last_row - Rows from this one on are ignored
+         * @return int - Number of blobs found, at most MAX_BLOBS
+         */
+        int label(const BitMask<W, H>& mask, int first_row = 0, int last_row = H) {
+            first_row = first_row < 0 ? 0 : first_row;
+            last_row = last_row > H ? H : last_row;
+            run_count_ = 0;
+            blob_count_ = 0;
+            largest_ = -1;
+            overflowed_ = false;
+
+            int prev_start = 0;
+            int prev_end = 0;
+            for (int y = first_row; y < last_row; y++) {
+                const int start = run_count_;
+                extract_runs(mask.row(y), y);
+                merge_rows(prev_start, prev_end, start, run_count_);
+                prev_start = start;
+                prev_end = run_count_;
+            }
+
+            accumulate();
+            return blob_count_;
+        }
+
+        /// @brief Number of blobs found by the last label()
+        int size() const { return blob_count_; }
+
+        /// @brief A blob found by the last label(), in order of their top-left pixel
+        const Blob& blob(int i) const { return blobs_[i]; }
+
+        /// @brief Index of the blob with the most pixels (the first one on a tie), -1 if none
+        int largest() const { return largest_; }
+
+        /// @brief True if the last label() found more than MAX_BLOBS blobs
+        bool overflowed() const { return overflowed_; }
+
+    private:
+        struct Run {
+            uint8_t y;
+            uint8_t x0;     ///< First pixel of the run
+            uint8_t x1;     ///< One past the last pixel of the run
+        };
+
+        static_assert(W <= 255 && H <= 255, "Runs store coordinates in 8 bits");
+
+        void add_run(int y, int x0, int x1) {
+            runs_[run_count_] = {static_cast<uint8_t>(y), static_cast<uint8_t>(x0), static_cast<uint8_t>(x1)};
+            parent_[run_count_] = run_count_;
+            run_count_++;
+        }
+
+        void extract_runs(const uint32_t* words, int y) {
+            constexpr int WORDS = BitMask<W, H>::WORDS_PER_ROW;
+            int run_start = -1;
+            for (int w = 0; w < WORDS; w++) {
+                const uint32_t bits = words[w];
+                int pos = 0;
+                while (pos < 32) {
+                    if (run_start < 0) {
+                        const uint32_t rest = bits >> pos;
+                        if (rest == 0) {
+                            break;
+                        }
+                        pos += __builtin_ctz(rest);
+                        run_start = 32 * w + pos;
+                    } else {
+                        const uint32_t rest = ~bits >> pos;
+                        if (rest == 0) {
+                            break;
+                        }
+                        pos += __builtin_ctz(rest);
+                        add_run(y, run_start, 32 * w + pos);
+                        run_start = -1;
+                    }
+                }
+            }
+            if (run_start >= 0) {
+                add_run(y, run_start, W);
+            }
+        }
+
+        int find(int i) {
+            while (parent_[i] != i) {
+                parent_[i] = parent_[parent_[i]];
+                i = parent_[i];
+            }
+            return i;
+        }
+
+        void unite(int a, int b) {
+            a = find(a);
+            b = find(b);
+            // The earlier run stays the root, so every root is its blob's first run
+            if (a < b) {
+                parent_[b] = a;
+            } else if (b < a) {
+                parent_[a] = b;
+            }
+        }
+
+        // Merge runs of the current row with the 8-connected runs above them
+        void merge_rows(int above, int above_end, int current, int current_end) {
+            if (above == above_end || current == current_end) {
+                return;
+            }
+            int a = above;
+            for (int c = current; c < current_end; c++) {
+                const Run& run = runs_[c];
+                while (a < above_end && runs_[a].x1 < run.x0) {
+                    a++;
+                }
+                for (int i = a; i < above_end && runs_[i].x0 <= run.x1; i++) {
+                    unite(i, c);
+                }
+            }
+        }
+
+        void accumulate() {
+            // Point every run straight at its root and total the area of each
+            // blob on its root, so the largest blob is known before any slots
+            // are handed out. blob_of_ holds the areas until the second pass.
+            int roots = 0;
+            for (int i = 0; i < run_count_; i++) {
+                const int root = find(i);
+                parent_[i] = root;
+                if (root == i) {
+                    blob_of_[i] = 0;
+                    roots++;
+                }
+                blob_of_[root] += runs_[i].x1 - runs_[i].x0;
+            }
+
+            int largest_root = -1;
+            int largest_rank = 0;
+            for (int i = 0, rank = 0; i < run_count_; i++) {
+                if (parent_[i] != i) {
+                    continue;
+                }
+                if (largest_root < 0 || blob_of_[i] > blob_of_[largest_root]) {
+                    largest_root = i;
+                    largest_rank = rank;
+                }
+                rank++;
+            }
+
+            // The last slot goes to the largest blob if it would not get one in raster order
+            overflowed_ = roots > MAX_BLOBS;
+            const int raster_slots = largest_rank >= MAX_BLOBS ? MAX_BLOBS - 1 : MAX_BLOBS;
+
+            // Roots come before their other runs, so blobs are created in raster order
+            for (int i = 0; i < run_count_; i++) {
+                const Run& run = runs_[i];
+                const int root = parent_[i];
+                int index;
+                if (root == i) {
+                    if (blob_count_ >= raster_slots && i != largest_root) {
+                        blob_of_[i] = UINT16_MAX;
+                        continue;
+                    }
+                    index = blob_count_++;
+                    if (i == largest_root) {
+                        largest_ = index;
+                    }
+                    blob_of_[i] = index;
+                    Blob& blob = blobs_[index];
+                    blob = {};
+                    blob.bounds = {run.x0, run.y, run.x1, run.y + 1};
+                    blob.top_left = {run.x0, run.y};
+                    blob.bottom_left = {run.x0, run.y};
+                } else {
+                    index = blob_of_[root];
+                    if (index == UINT16_MAX) {
+                        continue;
+                    }
+                }
+
+                Blob& blob = blobs_[index];
+                const int length = run.x1 - run.x0;
+                blob.area += length;
+                blob.moments.add_run(run.y, run.x0, run.x1);
+                blob.bounds.x0 = run.x0 < blob.bounds.x0 ? run.x0 : blob.bounds.x0;
+                blob.bounds.x1 = run.x1 > blob.bounds.x1 ? run.x1 : blob.bounds.x1;
+                blob.bounds.y1 = run.y + 1;
+                if (run.y > blob.bottom_left.y) {
+                    blob.bottom_left = {run.x0, run.y};
+                }
+            }
+
+            for (int i = 0; i < blob_count_; i++) {
+                const Moments& m = blobs_[i].moments;
+                blobs_[i].centroid = {m.m10 / m.m00, m.m01 / m.m00};
+            }
+        }
+
+        Run runs_[MAX_RUNS];
+        uint16_t parent_[MAX_RUNS];
+        uint16_t blob_of_[MAX_RUNS];
+        Blob blobs_[MAX_BLOBS];
+        int run_count_ = 0;
+        int blob_count_ = 0;
+        int largest_ = -1;
+        bool overflowed_ = false;
+    };
+}
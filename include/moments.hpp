@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Vision {
+
+    /**
+     * @brief Raw image moments of a set of pixels, accumulated with integers only
+     *
+     * For a 96x96 frame the largest second order moment is under 2^27, so
+     * 32 bits are plenty.
+     */
+    struct Moments {
+        int32_t m00;    ///< Number of pixels
+        int32_t m10;    ///< Sum of x
+        int32_t m01;    ///< Sum of y
+        int32_t m20;    ///< Sum of x^2
+        int32_t m11;    ///< Sum of x * y
+        int32_t m02;    ///< Sum of y^2
+
+        /**
+         * @brief Add a horizontal run of pixels using closed forms for its sums
+         *
+         * @param y - Row of the run
+         * @param x0 - First pixel of the run
+         * @param x1 - One past the last pixel of the run
+         */
+        void add_run(int y, int x0, int x1) {
+            const int32_t length = x1 - x0;
+            const int32_t sum_x = (x0 + x1 - 1) * length / 2;
+            m00 += length;
+            m10 += sum_x;
+            m01 += y * length;
+            m20 += square_sum(x1 - 1) - square_sum(x0 - 1);
+            m11 += y * sum_x;
+            m02 += y * y * length;
+        }
+
+    private:
+        // 0^2 + 1^2 + ... + n^2
+        static int32_t square_sum(int32_t n) { return n < 0 ? 0 : n * (n + 1) * (2 * n + 1) / 6; }
+    };
+
+    /// @brief Line through a blob along its principal axis, in fixed point
+    struct LineFit {
+        int32_t x0_q8;      ///< Centroid x in 24.8 fixed point
+        int32_t y0_q8;      ///< Centroid y in 24.8 fixed point
+        int32_t angle_q16;  ///< Angle of the axis from the x axis in radians, 16.16, within (-pi/2, pi/2]
+        int16_t vx_q14;     ///< Unit direction x in 2.14 fixed point, like vx of cv::fitLine
+        int16_t vy_q14;     ///< Unit direction y in 2.14 fixed point, like vy of cv::fitLine
+    };
+
+    /**
+     * @brief Fit a line to a blob from its moments
+     *
+     * The orientation comes from the central second moments,
+     * theta = atan2(2 mu11, mu20 - mu02) / 2, evaluated with CORDIC so there
+     * is no floating point and the only divisions are two integer ones for
+     * the centroid. For a filled blob this is the least squares (DIST_L2)
+     * line through its pixels.
+     *
+     * @param moments - Moments of the blob, m00 must not be 0
+     * @return LineFit - The centroid and direction of the line
+     */
+    LineFit fit_line(const Moments& moments);
+}
\ No newline at end of file
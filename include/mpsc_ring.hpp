@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Lock-free multi-producer/single-consumer ring buffer
+ *
+ * Any number of tasks may push while one task pops. Each slot carries a
+ * sequence number that tells whether it is free for the producer claiming
+ * that position or filled for the consumer, so a producer preempted halfway
+ * through a push never blocks the others; the consumer only waits for that
+ * one slot.
+ *
+ * @tparam T - Element type, copied in and out of the ring
+ * @tparam N - Capacity of the ring, a power of two
+ */
+template <typename T, size_t N>
+class MpscRing {
+public:
+    static_assert(N > 0 && (N & (N - 1)) == 0, "MpscRing needs a power of two capacity");
+
+    MpscRing() {
+        for (size_t i = 0; i < N; i++) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    /**
+     * @brief Push an element from any producer
+     *
+     * @param item - The element to push
+     * @return true - The element was stored
+     * @return false - The ring was full and nothing was stored
+     */
+    bool try_push(const T& item) {
+        size_t position = head_.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &slots_[position & (N - 1)];
+            const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const intptr_t lag = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (lag == 0) {
+                // The slot is free, claim the position unless another producer got there first
+                if (head_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (lag < 0) {
+                // The consumer has not freed the slot from the previous lap yet
+                return false;
+            } else {
+                position = head_.load(std::memory_order_relaxed);
+            }
+        }
+        slot->item = item;
+        slot->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Pop an element from the consumer side
+     *
+     * @param item - Receives the oldest element
+     * @return true - An element was popped
+     * @return false - The ring was empty, or its oldest element is still being written
+     */
+    bool try_pop(T& item) {
+        Slot& slot = slots_[tail_ & (N - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != tail_ + 1) {
+            return false;
+        }
+        item = slot.item;
+        slot.sequence.store(tail_ + N, std::memory_order_release);
+        tail_++;
+        return true;
+    }
+
+    /// @brief Number of elements the ring can hold
+    static constexpr size_t capacity() { return N; }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    Slot slots_[N];
+    std::atomic<size_t> head_{0};
+    size_t tail_ = 0;   ///< Only touched by the consumer
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_cpu.h"
+
+/**
+ * @brief Scoped timers for the hot path, reported as per-stage histograms
+ *
+ * PROFILE_SCOPE(Stage) reads the cycle counter (CCOUNT on the ESP32, the
+ * steady clock on the host) when it is declared and again when it goes out
+ * of scope, and adds the difference to that stage's histogram on the current
+ * core. Recording only uses relaxed atomic adds, so it never blocks and tasks
+ * on different cores never share a counter.
+ *
+ * Profiling is compiled in only when PROFILE_ENABLED is 1 (idf.py -DPROFILE=ON
+ * build). Otherwise PROFILE_SCOPE expands to nothing and no histograms are
+ * allocated.
+ */
+namespace Profile {
+
+    /// @brief Tag used in ESP debug logs
+    static const char* TAG = "PROFILE";
+
+    /// @brief The timed stages. Each has a histogram per core.
+    enum class Stage : uint8_t {
+        FrameGet,   ///< Waiting for esp_camera_fb_get()
+        Warmup,     ///< Colour statistics of one warm-up frame
+        FileName,   ///< SDCard::get_next_filename()
+        FileWrite,  ///< Writing one frame to its own file
+        Append,     ///< Appending one frame to a container
+        Queue,      ///< Handing one frame to the write-behind task
+        Segment,    ///< Vision::segment()
+        WhiteLine,  ///< WhiteLineDetector::detect()
+        COUNT
+    };
+
+    /// @brief Number of timed stages
+    constexpr size_t STAGE_COUNT = static_cast<size_t>(Stage::COUNT);
+
+    /// @brief Histogram buckets per power of two, as a power of two
+    constexpr int SUB_BITS = 3;
+
+    /// @brief Histogram buckets, enough for any 32 bit cycle count
+    constexpr size_t BUCKET_COUNT = (32 - SUB_BITS + 1) << SUB_BITS;
+
+    /**
+     * @brief Histogram bucket of a cycle count
+     *
+     * Counts below 2^SUB_BITS have a bucket each. Above that every power of
+     * two is split into 2^SUB_BITS equal buckets, so a bucket is never wider
+     * than 1/8 of the values in it.
+     *
+     * @param cycles - The cycle count
+     * @return size_t - The bucket, below BUCKET_COUNT
+     */
+    constexpr size_t bucket_of(uint32_t cycles) {
+        if (cycles < (1u << SUB_BITS)) {
+            return cycles;
+        }
+        const int exponent = 31 - __builtin_clz(cycles) - SUB_BITS;
+        return ((exponent + 1) << SUB_BITS) + ((cycles >> exponent) & ((1u << SUB_BITS) - 1));
+    }
+
+    /**
+     * @brief Smallest cycle count that falls in a bucket
+     *
+     * @param bucket - The bucket
+     * @return uint32_t - The lower bound of the bucket
+     */
+    constexpr uint32_t bucket_floor(size_t bucket) {
+        if (bucket < (1u << SUB_BITS)) {
+            return static_cast<uint32_t>(bucket);
+        }
+        const int exponent = static_cast<int>(bucket >> SUB_BITS) - 1;
+        return static_cast<uint32_t>((1u << SUB_BITS) + (bucket & ((1u << SUB_BITS) - 1))) << exponent;
+    }
+
+    static_assert(bucket_of(0xFFFFFFFF) == BUCKET_COUNT - 1, "The last bucket must hold the largest count");
+
+    /// @brief Summary of one stage over all cores
+    struct Summary {
+        uint32_t count;     ///< Number of timed scopes
+        uint32_t min;       ///< Shortest scope, in cycles
+        uint32_t max;       ///< Longest scope, in cycles
+        uint64_t total;     ///< Sum of all scopes, in cycles
+        uint32_t p99;       ///< 99th percentile, in cycles, to within half a bucket
+    };
+
+    /**
+     * @brief Add one timed scope to a stage's histogram on the current core
+     *
+     * @param stage - The stage that was timed
+     * @param cycles - How long it took
+     */
+    void record(Stage stage, uint32_t cycles);
+
+    /**
+     * @brief Merge a stage's histograms from every core
+     *
+     * @param stage - The stage to summarise
+     * @return Summary - All zero if the stage was never timed
+     */
+    Summary summarize(Stage stage);
+
+    /// @brief Clear every histogram
+    void reset();
+
+    /**
+     * @brief Print the count, min, mean, p99 and max time of every timed stage
+     */
+    void log_report();
+
+    /// @brief Name of a stage for reports
+    const char* stage_name(Stage stage);
+
+    /// @brief Times the scope it is declared in, see PROFILE_SCOPE
+    class Scope {
+    public:
+        explicit Scope(Stage stage) : stage_(stage), start_(esp_cpu_get_cycle_count()) {}
+        ~Scope() { record(stage_, static_cast<uint32_t>(esp_cpu_get_cycle_count() - start_)); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Stage stage_;
+        esp_cpu_cycle_count_t start_;
+    };
+}
+
+#ifndef PROFILE_ENABLED
+#define PROFILE_ENABLED 0
+#endif
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#if PROFILE_ENABLED
+/// @brief Time the rest of the enclosing scope as the given Profile::Stage
+#define PROFILE_SCOPE(stage) Profile::Scope PROFILE_CONCAT(profile_scope_, __LINE__)(Profile::Stage::stage)
+#else
+#define PROFILE_SCOPE(stage) static_assert(Profile::Stage::stage < Profile::Stage::COUNT, "")
+#endif
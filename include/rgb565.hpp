@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Helpers for reading packed RGB565 pixels as delivered by the camera
+ *
+ * The sensor sends each pixel high byte first, so byte 0 holds the 5 red bits
+ * and the top 3 green bits, and byte 1 holds the low 3 green bits and the 5
+ * blue bits. Channels are widened to 0-255 the same way openimages.py does
+ * (value / 32 * 255, truncated), so thresholds tuned in Python carry over.
+ */
+namespace RGB565 {
+
+    /// @brief Combine the two bytes of a pixel into its 16 bit code
+    constexpr uint16_t code(const uint8_t* px) {
+        return static_cast<uint16_t>((px[0] << 8) | px[1]);
+    }
+
+    /// @brief 5 bit red channel of a pixel code
+    constexpr uint8_t red5(uint16_t code) { return (code >> 11) & 0x1F; }
+
+    /// @brief 6 bit green channel of a pixel code
+    constexpr uint8_t green6(uint16_t code) { return (code >> 5) & 0x3F; }
+
+    /// @brief 5 bit blue channel of a pixel code
+    constexpr uint8_t blue5(uint16_t code) { return code & 0x1F; }
+
+    /// @brief Red channel widened to 0-255
+    constexpr uint8_t red8(uint16_t code) { return (red5(code) * 255) >> 5; }
+
+    /// @brief Green channel widened to 0-255
+    constexpr uint8_t green8(uint16_t code) { return (green6(code) * 255) >> 6; }
+
+    /// @brief Blue channel widened to 0-255
+    constexpr uint8_t blue8(uint16_t code) { return (blue5(code) * 255) >> 5; }
+}
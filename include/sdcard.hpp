@@ -11,15 +11,18 @@ namespace SDCard {
     /// @brief Tag used in ESP debug logs
     static const char *TAG = "SD_Card";
 
+    /// @brief Number of images handed out between writes of the image counter to CONFIG_FILE
+    constexpr int COUNTER_PERSIST_INTERVAL = 16;
+
     /**
-     * @brief Mount the SD Card
+     * @brief Mount the SD Card and load the image counter
      * 
      * @return esp_err_t - ESP_OK if the SD card was successfully mounted
      */
     esp_err_t mount_sd_card();
 
     /**
-     * @brief Unmount the SD Card
+     * @brief Save the image counter and unmount the SD Card
      * 
      * @return esp_err_t - ESP_OK if the SD card was successfully dismounted
      */
@@ -28,7 +31,28 @@ namespace SDCard {
     /**
      * @brief Get the file name to save the next image as
      * 
+     * The counter is kept in RAM and only written back to CONFIG_FILE every
+     * COUNTER_PERSIST_INTERVAL images and on unmount.
+     * 
      * @param filename - Buffer to store the next file name in
      */
     void get_next_filename(char *filename);
+
+    /**
+     * @brief Load the image counter from CONFIG_FILE
+     * 
+     * If the stored number is missing or stale (its image already exists, e.g.
+     * after a reset before the counter was saved), the card is scanned for the
+     * highest existing image number instead.
+     * 
+     * @return int - The number the next image will be saved under
+     */
+    int load_image_counter();
+
+    /**
+     * @brief Write the image counter back to CONFIG_FILE if it has changed
+     * 
+     * @return esp_err_t - ESP_OK if the counter is saved
+     */
+    esp_err_t flush_image_counter();
 }
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <esp_err.h>
+#include "esp_camera.h"
+
+/**
+ * @brief Persist the converged sensor exposure and white balance in NVS
+ *
+ * After a good capture the auto exposure, gain and white balance registers
+ * are snapshotted into the nvs partition. Writing them back on the next boot
+ * starts the sensor close to where it settled last time, so only a frame or
+ * two of warm-up is needed.
+ */
+namespace SensorState {
+
+    /// @brief Tag used in ESP debug logs
+    static const char* TAG = "SENSOR_STATE";
+
+    /// @brief NVS namespace the snapshot is stored under
+    static const char* NVS_NAMESPACE = "camera";
+
+    /// @brief NVS key of the register snapshot
+    static const char* NVS_KEY = "sensor_regs";
+
+    /**
+     * @brief Initialise the NVS flash partition, erasing it if it is full or outdated
+     *
+     * @return esp_err_t - ESP_OK if NVS is ready to use
+     */
+    esp_err_t init_nvs();
+
+    /**
+     * @brief Snapshot the sensor's converged registers into NVS
+     *
+     * Nothing is written when the stored snapshot already holds the same values.
+     *
+     * @param sensor - The sensor to read the registers from
+     * @return esp_err_t - ESP_OK if the snapshot was stored or already up to date
+     */
+    esp_err_t save(sensor_t* sensor);
+
+    /**
+     * @brief Write a stored snapshot back to the sensor
+     *
+     * Auto exposure, gain and white balance are switched to manual while the
+     * registers are written, so the sensor takes the stored values, then put
+     * back in their previous mode. The snapshot is only a seed: the auto loops
+     * carry on from it and the usual warm-up still checks they have settled.
+     *
+     * @param sensor - The sensor to write the registers to
+     * @return esp_err_t - ESP_OK if a snapshot for this sensor was found and written,
+     *                     ESP_ERR_NOT_FOUND if there is no usable snapshot
+     */
+    esp_err_t restore(sensor_t* sensor);
+
+    /**
+     * @brief Delete the stored snapshot
+     *
+     * @return esp_err_t - ESP_OK if the snapshot was removed or did not exist
+     */
+    esp_err_t clear();
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include "vision.hpp"
+
+/**
+ * @brief Colour kernels that work on two RGB565 pixels packed in one 32 bit word
+ *
+ * The ESP32 has no vector unit, but a 32 bit register holds two pixels. Each
+ * pixel gets a 16 bit lane, and every channel value and threshold fits in 15
+ * bits, so adds, subtracts and multiplies by a constant never carry from one
+ * lane into the other. A comparison a > b + c is the sign of (a | 0x8000) - b
+ * - c - 1 in each lane, which is bit 15. Nothing here is target specific.
+ */
+namespace Swar {
+
+    /// @brief 1 in the low bit of both lanes
+    constexpr uint32_t LANE_ONES = 0x00010001;
+
+    /// @brief The top bit of both lanes, which holds comparison results
+    constexpr uint32_t LANE_SIGNS = 0x80008000;
+
+    /**
+     * @brief Load two pixels into one word, the first pixel's code in the low lane
+     *
+     * The camera sends each pixel high byte first, so the bytes of each 16 bit
+     * half are swapped after the load. memcpy keeps the load legal on any
+     * alignment; on an aligned pointer it compiles to a single 32 bit load.
+     *
+     * @param px - The first byte of the pair
+     * @return uint32_t - Code of the first pixel in bits 0-15, the second in bits 16-31
+     */
+    inline uint32_t load_pair(const uint8_t* px) {
+        uint32_t word;
+        memcpy(&word, px, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        word = (word << 16) | (word >> 16);
+#endif
+        return ((word & 0x00FF00FF) << 8) | ((word >> 8) & 0x00FF00FF);
+    }
+
+    /// @brief Red channel of both lanes widened to 0-255, as RGB565::red8
+    constexpr uint32_t red8(uint32_t codes) { return ((((codes >> 11) & 0x001F001F) * 255) >> 5) & 0x00FF00FF; }
+
+    /// @brief Green channel of both lanes widened to 0-255, as RGB565::green8
+    constexpr uint32_t green8(uint32_t codes) { return ((((codes >> 5) & 0x003F003F) * 255) >> 6) & 0x00FF00FF; }
+
+    /// @brief Blue channel of both lanes widened to 0-255, as RGB565::blue8
+    constexpr uint32_t blue8(uint32_t codes) { return (((codes & 0x001F001F) * 255) >> 5) & 0x00FF00FF; }
+
+    /**
+     * @brief Lane-wise a > b + c
+     *
+     * @param a - Lanes of at most 0x7FFF
+     * @param b - Lanes with b + c + 1 of at most 0x8000
+     * @param c - Constant added to both lanes of b
+     * @return uint32_t - LANE_SIGNS bits set in the lanes where the comparison holds
+     */
+    constexpr uint32_t greater(uint32_t a, uint32_t b, uint32_t c) {
+        return ((a | LANE_SIGNS) - b - (c + 1) * LANE_ONES) & LANE_SIGNS;
+    }
+
+    /**
+     * @brief Vision::classify on both lanes
+     *
+     * @param codes - Two pixel codes, as from load_pair()
+     * @return uint32_t - Vision::ClassBits of each pixel in the low byte of its lane
+     */
+    constexpr uint32_t classify_pair(uint32_t codes) {
+        const uint32_t r = red8(codes);
+        const uint32_t g = green8(codes);
+        const uint32_t b = blue8(codes);
+        const uint32_t red = greater(r, g, 20) & greater(r, b, 30);
+        const uint32_t white = greater(r, 0, 180) & greater(g, 0, 180) & greater(b, 0, 110);
+        const uint32_t green = greater(g, r, 50) & greater(g, b, 30);
+        return ((red >> 15) * Vision::CLASS_RED) | ((white >> 15) * Vision::CLASS_WHITE) |
+               ((green >> 15) * Vision::CLASS_GREEN);
+    }
+
+    /**
+     * @brief Classify a run of pixels two at a time
+     *
+     * @param px - RGB565 pixels, two bytes each
+     * @param count - Number of pixels
+     * @param out - Receives the Vision::ClassBits of each pixel
+     */
+    inline void classify_row(const uint8_t* px, int count, uint8_t* out) {
+        int x = 0;
+        for (; x + 1 < count; x += 2, px += 4) {
+            const uint32_t classes = classify_pair(load_pair(px));
+            out[x] = static_cast<uint8_t>(classes);
+            out[x + 1] = static_cast<uint8_t>(classes >> 16);
+        }
+        if (x < count) {
+            out[x] = Vision::classify(RGB565::code(px));
+        }
+    }
+
+    /**
+     * @brief Widen the channels of a run of pixels two at a time
+     *
+     * @param px - RGB565 pixels, two bytes each
+     * @param count - Number of pixels
+     * @param red - Receives the red channel of each pixel, 0-255
+     * @param green - Receives the green channel of each pixel, 0-255
+     * @param blue - Receives the blue channel of each pixel, 0-255
+     */
+    inline void extract_channels(const uint8_t* px, int count, uint8_t* red, uint8_t* green, uint8_t* blue) {
+        int x = 0;
+        for (; x + 1 < count; x += 2, px += 4) {
+            const uint32_t codes = load_pair(px);
+            const uint32_t r = red8(codes);
+            const uint32_t g = green8(codes);
+            const uint32_t b = blue8(codes);
+            red[x] = static_cast<uint8_t>(r);
+            red[x + 1] = static_cast<uint8_t>(r >> 16);
+            green[x] = static_cast<uint8_t>(g);
+            green[x + 1] = static_cast<uint8_t>(g >> 16);
+            blue[x] = static_cast<uint8_t>(b);
+            blue[x + 1] = static_cast<uint8_t>(b >> 16);
+        }
+        if (x < count) {
+            const uint16_t code = RGB565::code(px);
+            red[x] = RGB565::red8(code);
+            green[x] = RGB565::green8(code);
+            blue[x] = RGB565::blue8(code);
+        }
+    }
+}
@@ -0,0 +1,383 @@
+#pragma once
+
+#include <cstdint>
+#include "bit_mask.hpp"
+#include "geometry.hpp"
+#include "integral_image.hpp"
+#include "labeler.hpp"
+#include "moments.hpp"
+#include "rgb565.hpp"
+
+/**
+ * @brief On-device ports of the detectors prototyped in openimages.py
+ *
+ * Everything works directly on the packed RGB565 frame from the camera with
+ * integer arithmetic, and only looks at the pixels a detector actually needs.
+ */
+namespace Vision {
+
+    /// @brief Tag used in ESP debug logs
+    static const char* TAG = "VISION";
+
+    /**
+     * @brief An RGB565 frame, two bytes per pixel with the high byte first
+     *
+     * The frame may hold only a band of rows, from y0 to the bottom, when the
+     * rest was never captured. Coordinates are always those of the full frame
+     * and the detectors skip the rows above y0.
+     */
+    struct Frame {
+        const uint8_t* data;    ///< Pixels of rows y0 to height - 1
+        int width;
+        int height;             ///< Height of the full frame
+        int y0 = 0;             ///< First row held in data
+
+        /// @brief Pixels of row y, which must be at least y0
+        const uint8_t* row(int y) const { return data + 2 * (y - y0) * width; }
+
+        /// @brief Pixel code at column x, row y
+        uint16_t at(int x, int y) const { return RGB565::code(row(y) + 2 * x); }
+    };
+
+    /// @brief Largest frame the fixed-size detector buffers are sized for (FRAMESIZE_96X96)
+    constexpr int MAX_WIDTH = 96;
+    constexpr int MAX_HEIGHT = 96;
+    constexpr int MAX_PIXELS = MAX_WIDTH * MAX_HEIGHT;
+
+    /// @brief One bit per pixel mask of a whole frame
+    using Mask = BitMask<MAX_WIDTH, MAX_HEIGHT>;
+
+    /// @brief Summed-area table of a whole frame mask
+    using Integral = IntegralImage<MAX_WIDTH, MAX_HEIGHT>;
+
+    /// @brief Region checked for the red stop line, STOPBOX_TL/BR in openimages.py
+    constexpr Rect STOPBOX = {45, 75, 70, 90};
+
+    /// @brief Percentage of red pixels in the stop box that means stop
+    constexpr int PERCENT_TO_STOP = 10;
+
+    /// @brief Red mask predicate from applyRedMask: R > G + 20 and R > B + 30
+    constexpr bool is_red(uint16_t code) {
+        const int r = RGB565::red8(code);
+        return r > RGB565::green8(code) + 20 && r > RGB565::blue8(code) + 30;
+    }
+
+    /// @brief Region checked for a car, CARBOX_TL/BR in openimages.py
+    constexpr Rect CARBOX = {0, 40, 15, 70};
+
+    /// @brief Percentage of green pixels in the car box that means a car is there
+    constexpr int PERCENT_TO_CAR = 10;
+
+    /// @brief Car mask predicate from processCarImg: G > R + 50 and G > B + 30
+    constexpr bool is_green(uint16_t code) {
+        const int g = RGB565::green8(code);
+        return g > RGB565::red8(code) + 50 && g > RGB565::blue8(code) + 30;
+    }
+
+    /// @brief Rows up to and including this one are ignored by the white line search, as in applyWhiteCrop
+    constexpr int WHITE_CROP_ROW = 45;
+
+    /// @brief Column the white line's top-left point should sit on when driving straight
+    constexpr int WHITELINE_CENTER_POS = 28;
+
+    /// @brief White mask predicate from applyWhiteMask: R > 180, G > 180 and B > 110
+    constexpr bool is_white(uint16_t code) {
+        return RGB565::red8(code) > 180 && RGB565::green8(code) > 180 && RGB565::blue8(code) > 110;
+    }
+
+    /// @brief First row any detector looks at, so rows above it need not be captured
+    constexpr int FIRST_USED_ROW = CARBOX.y0 < STOPBOX.y0 ? CARBOX.y0 : STOPBOX.y0;
+    static_assert(WHITE_CROP_ROW + 1 >= FIRST_USED_ROW, "The white line search starts above FIRST_USED_ROW");
+
+    /// @brief Outcome of checking a box for enough matching pixels
+    struct BoxResult {
+        int count;      ///< Matching pixels found (a lower bound if the scan stopped early)
+        int total;      ///< Pixels in the box
+        int percent;    ///< 100 * count / total, rounded down
+        bool triggered; ///< True if the percentage reached the threshold
+        bool complete;  ///< False if the scan stopped early once the threshold was reached
+        int pixels_read;    ///< Frame pixels read to get this result, 0 if it came from a segmentation
+    };
+
+    /**
+     * @brief Build the result for a box from the number of matching pixels in it
+     *
+     * @param count - Matching pixels in the box
+     * @param total - Pixels in the box
+     * @param threshold_percent - Percentage of matching pixels that triggers the result
+     * @return BoxResult - The percentage and decision for the box
+     */
+    constexpr BoxResult box_result(int count, int total, int threshold_percent)
+    {
+        BoxResult result = {count, total, 0, false, true, 0};
+        if (total > 0) {
+            result.percent = count * 100 / total;
+            result.triggered = count * 100 >= threshold_percent * total;
+        }
+        return result;
+    }
+
+    /**
+     * @brief Count the pixels of a box that match a predicate
+     *
+     * @param frame - The frame to look at
+     * @param box - The box to count in, clipped to the rows and columns the frame holds
+     * @param threshold_percent - Percentage of matching pixels that triggers the result
+     * @param early_exit - Stop counting as soon as the threshold is reached
+     * @param predicate - Called with each pixel code, returns true for a match
+     * @return BoxResult - The count and decision for the box
+     */
+    template <typename Predicate>
+    BoxResult count_in_box(const Frame& frame, Rect box, int threshold_percent, bool early_exit,
+                           Predicate predicate)
+    {
+        box.x0 = box.x0 < 0 ? 0 : box.x0;
+        box.y0 = box.y0 < frame.y0 ? frame.y0 : box.y0;
+        box.x1 = box.x1 > frame.width ? frame.width : box.x1;
+        box.y1 = box.y1 > frame.height ? frame.height : box.y1;
+
+        BoxResult result = {0, 0, 0, false, true, 0};
+        if (box.x1 <= box.x0 || box.y1 <= box.y0) {
+            return result;
+        }
+        result.total = box.area();
+
+        // Smallest count with count * 100 >= threshold * total
+        const int needed = (threshold_percent * result.total + 99) / 100;
+        int count = 0;
+        int rows = 0;
+        for (int y = box.y0; y < box.y1; y++) {
+            const uint8_t* px = frame.row(y) + 2 * box.x0;
+            for (int x = box.x0; x < box.x1; x++, px += 2) {
+                count += predicate(RGB565::code(px));
+            }
+            rows++;
+            if (early_exit && count >= needed) {
+                result.complete = (y == box.y1 - 1);
+                break;
+            }
+        }
+        result.pixels_read = rows * (box.x1 - box.x0);
+
+        result.count = count;
+        result.percent = count * 100 / result.total;
+        result.triggered = count >= needed;
+        return result;
+    }
+
+    /**
+     * @brief Check the stop box for the red stop line, as drawStopBox does
+     *
+     * @param frame - The frame to look at
+     * @param early_exit - Stop counting as soon as enough red has been seen
+     * @return BoxResult - The red percentage and whether to stop
+     */
+    BoxResult detect_stop_box(const Frame& frame, bool early_exit = true);
+
+    /**
+     * @brief Check the car box for a green car, as drawCarBox does
+     *
+     * @param frame - The frame to look at
+     * @param early_exit - Stop counting as soon as enough green has been seen
+     * @return BoxResult - The green percentage and whether a car is present
+     */
+    BoxResult detect_car_box(const Frame& frame, bool early_exit = true);
+
+    /// @brief Class bits a pixel can carry in a segmentation
+    enum ClassBits : uint8_t {
+        CLASS_RED = 1 << 0,
+        CLASS_WHITE = 1 << 1,
+        CLASS_GREEN = 1 << 2,
+    };
+
+    /// @brief Evaluate every colour predicate on a pixel
+    constexpr uint8_t classify(uint16_t code) {
+        return (is_red(code) ? CLASS_RED : 0)
+             | (is_white(code) ? CLASS_WHITE : 0)
+             | (is_green(code) ? CLASS_GREEN : 0);
+    }
+
+    /**
+     * @brief Class bits of every pixel plus the counts each detector needs
+     *
+     * Produced by segment() in a single pass over the frame, so the red, white
+     * and green detectors do not each read the frame from PSRAM again.
+     */
+    struct Segmentation {
+        int width;
+        int height;
+        uint8_t classes[MAX_PIXELS];    ///< ClassBits of each pixel, row by row
+        Mask red_mask;      ///< Pixels with CLASS_RED
+        Mask white_mask;    ///< Pixels with CLASS_WHITE
+        Mask green_mask;    ///< Pixels with CLASS_GREEN
+        int stop_red;       ///< Red pixels inside STOPBOX
+        int car_green;      ///< Green pixels inside CARBOX
+        int white;          ///< White pixels below WHITE_CROP_ROW
+        uint32_t bytes_read;    ///< Frame bytes read to produce this segmentation
+
+        /// @brief Class bits of the pixel at column x, row y
+        uint8_t at(int x, int y) const { return classes[y * width + x]; }
+
+        /// @brief Stop box result, as detect_stop_box without early exit
+        BoxResult stop_box() const { return box_result(stop_red, STOPBOX.area(), PERCENT_TO_STOP); }
+
+        /// @brief Car box result, as detect_car_box without early exit
+        BoxResult car_box() const { return box_result(car_green, CARBOX.area(), PERCENT_TO_CAR); }
+    };
+
+    /// @brief Summed-area tables of each class, for constant time region counts
+    struct Integrals {
+        Integral red;
+        Integral white;
+        Integral green;
+
+        /// @brief The table of a single class bit
+        const Integral& of(ClassBits cls) const {
+            return cls == CLASS_RED ? red : cls == CLASS_WHITE ? white : green;
+        }
+    };
+
+    /**
+     * @brief Classify every pixel of a frame and count the detector regions in one pass
+     *
+     * @param frame - The frame to segment, at most MAX_WIDTH x MAX_HEIGHT. Rows
+     *                above frame.y0 get no class bits.
+     * @param out - Receives the class bits and region counts
+     * @param lut - Optional table of class bits per RGB565 code (see ClassLut)
+     *              used instead of evaluating the predicates two pixels at a
+     *              time (see Swar)
+     * @param integrals - Optionally filled with the summed-area table of each class
+     */
+    void segment(const Frame& frame, Segmentation& out, const uint8_t* lut = nullptr,
+                 Integrals* integrals = nullptr);
+
+    /**
+     * @brief A fixed set of regions whose occupancy is checked every frame
+     *
+     * Regions are registered once, then all of them are evaluated against the
+     * summed-area tables at four lookups each.
+     */
+    class RoiSet {
+    public:
+        /// @brief Most regions a set can hold
+        static constexpr int MAX_ROIS = 16;
+
+        /**
+         * @brief Register a region
+         *
+         * @param box - The region; the part outside the frame is ignored, as in count_in_box()
+         * @param cls - The class to count inside it
+         * @param threshold_percent - Occupancy that triggers the region
+         * @return int - Index of the region in evaluate()'s output, -1 if the set is full
+         */
+        int add(const Rect& box, ClassBits cls, int threshold_percent);
+
+        /// @brief Number of registered regions
+        int size() const { return count_; }
+
+        /**
+         * @brief Evaluate every registered region
+         *
+         * @param integrals - Summed-area tables from segment()
+         * @param out - Receives size() results, in registration order
+         */
+        void evaluate(const Integrals& integrals, BoxResult* out) const;
+
+    private:
+        struct Roi {
+            Rect box;
+            ClassBits cls;
+            int threshold_percent;
+        };
+
+        Roi rois_[MAX_ROIS];
+        int count_ = 0;
+    };
+
+    /// @brief Outcome of the white line search
+    struct SteeringResult {
+        bool found;         ///< False if there was no white pixel below the crop row
+        int area;           ///< Pixels in the largest white blob
+        Point centroid;     ///< Centroid of the blob, rounded down
+        Point top_left;     ///< Leftmost pixel of the blob's top row
+        Point bottom_left;  ///< Leftmost pixel of the blob's bottom row
+        int steering;       ///< top_left.x - WHITELINE_CENTER_POS, as steeringValue in openimages.py
+        LineFit line;       ///< Principal axis of the blob, in place of cv::fitLine
+        Rect bounds;        ///< Bounding box of the blob
+        bool tracked;       ///< True if the blob was found inside the window around the previous one
+        int pixels_touched; ///< Pixels searched for this result, including a fallback full search
+        int search_area;    ///< Pixels a full search below the crop row covers
+    };
+
+    /**
+     * @brief Finds the white line and the steering value, as processWhiteImgV2 does
+     *
+     * The largest 8-connected white blob below WHITE_CROP_ROW is found with a
+     * run-length connected components pass over fixed-size buffers held by the
+     * detector, so there is no heap allocation and the work is bounded by the
+     * frame size. Blobs are ranked by pixel count rather than by the area of
+     * their outer contour. Keep one detector per task that uses it.
+     *
+     * With tracking enabled the detector remembers the bounding box of the
+     * line and searches only that box grown by a margin in the next frame. It
+     * falls back to a full search when the line is lost, shrinks to less than
+     * half its previous area, or touches the edge of the window, since it may
+     * then reach outside it. A larger blob that appears away from the tracked
+     * line is not seen until the next fallback.
+     */
+    class WhiteLineDetector {
+    public:
+        /**
+         * @brief Run the white line search on a frame
+         *
+         * @param frame - The frame to look at, at most MAX_WIDTH x MAX_HEIGHT
+         * @return SteeringResult - The largest blob and the steering value
+         */
+        SteeringResult detect(const Frame& frame);
+
+        /**
+         * @brief Run the white line search on the white bits of a segmentation
+         *
+         * @overload
+         * @param segmentation - The segmented frame
+         * @return SteeringResult - The largest blob and the steering value
+         */
+        SteeringResult detect(const Segmentation& segmentation);
+
+        /// @brief The labeling of the white mask from the last detect()
+        const Labeler<MAX_WIDTH, MAX_HEIGHT>& labeler() const { return labeler_; }
+
+        /// @brief Pixels the search window extends past the previous line's bounding box
+        static constexpr int TRACK_MARGIN = 8;
+
+        /// @brief Smallest blob worth tracking, so a speck of noise does not hold the window
+        static constexpr int TRACK_MIN_AREA = 16;
+
+        /**
+         * @brief Turn searching around the previous line on or off
+         *
+         * @param enabled - Whether to track the line between frames
+         * @param margin - Pixels to grow the previous bounding box by
+         */
+        void set_tracking(bool enabled, int margin = TRACK_MARGIN);
+
+        /// @brief Forget the previous line so the next detect() searches the whole frame
+        void reset_track() { have_track_ = false; }
+
+    private:
+        template <typename Source>
+        SteeringResult search(const Source& source, int width, int first_row, int height);
+
+        void mask_window(const Frame& frame, const Rect& window);
+        void mask_window(const Mask& mask, const Rect& window);
+        SteeringResult find_line(const Rect& window);
+
+        Mask mask_;
+        Labeler<MAX_WIDTH, MAX_HEIGHT> labeler_;
+        bool tracking_ = false;
+        int margin_ = TRACK_MARGIN;
+        bool have_track_ = false;
+        Rect track_ = {};
+        int track_area_ = 0;
+    };
+}
\ No newline at end of file
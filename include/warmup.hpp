@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Sensor warm-up that stops once white balance and exposure settle
+ *
+ * Right after boot the sensor produces yellow tinted frames while its
+ * automatic white balance and exposure converge. Rather than discarding a
+ * fixed number of frames, the controller tracks cheap colour statistics of
+ * each frame and reports the sensor as settled once they stop moving.
+ */
+namespace Warmup {
+
+    /// @brief Tag used in ESP debug logs
+    static const char* TAG = "WARMUP";
+
+    /// @brief Colour statistics of a frame, channels on a 0-255 scale
+    struct FrameStats {
+        uint8_t mean_r;
+        uint8_t mean_g;
+        uint8_t mean_b;
+        uint8_t luma;
+        uint16_t chroma_ratio;  ///< (R + G) / 2B in 8.8 fixed point, high while the image is yellow
+    };
+
+    /// @brief Tuning for when a sequence of frames counts as settled
+    struct Config {
+        int min_frames = 2;         ///< Always discard at least this many frames
+        int max_frames = 10;        ///< Give up waiting after this many frames
+        int stable_frames = 2;      ///< Consecutive frames that must agree with their predecessor
+        uint8_t tolerance = 3;      ///< Largest allowed change of any channel mean or the luma
+        uint16_t ratio_tolerance = 8;   ///< Largest allowed change of the chroma ratio
+        int sample_step = 4;        ///< Only every n-th pixel is sampled
+    };
+
+    /**
+     * @brief Compute the colour statistics of an RGB565 frame
+     *
+     * @param data - The RGB565 pixels, high byte first
+     * @param len - Length of the frame in bytes
+     * @param sample_step - Only every n-th pixel is sampled
+     * @return FrameStats - The statistics of the frame
+     */
+    FrameStats compute_stats(const uint8_t* data, size_t len, int sample_step = 1);
+
+    /**
+     * @brief Decides frame by frame whether the sensor has settled
+     *
+     * Frames can come from the camera or from a recorded warm-up sequence.
+     */
+    class Controller {
+    public:
+        explicit Controller(const Config& config = Config()) : config_(config) {}
+
+        /**
+         * @brief Feed the next warm-up frame
+         *
+         * @param data - The RGB565 pixels, high byte first
+         * @param len - Length of the frame in bytes
+         * @return true - The sensor has settled or the frame cap was reached
+         * @return false - More frames are needed
+         */
+        bool update(const uint8_t* data, size_t len);
+
+        /// @brief True once update() has reported the sensor as settled
+        bool done() const { return done_; }
+
+        /// @brief True if warm-up ended because the statistics converged rather than at the cap
+        bool converged() const { return converged_; }
+
+        /// @brief Number of frames fed so far
+        int frames() const { return frames_; }
+
+        /// @brief Statistics of the last frame fed
+        const FrameStats& last_stats() const { return last_; }
+
+    private:
+        bool is_close(const FrameStats& a, const FrameStats& b) const;
+
+        Config config_;
+        FrameStats last_ = {};
+        int frames_ = 0;
+        int stable_ = 0;
+        bool done_ = false;
+        bool converged_ = false;
+    };
+
+    /**
+     * @brief Capture and discard frames until the sensor has settled
+     *
+     * @param config - When to consider the sensor settled
+     * @param converged - Optionally set to whether the sensor settled before the frame cap
+     * @return int - The number of frames that were discarded
+     */
+    int run(const Config& config = Config(), bool* converged = nullptr);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <esp_err.h>
+#include "container.hpp"
+#include "freertos/FreeRTOS.h"
+
+/**
+ * @brief Asynchronous frame storage on a background writer task
+ *
+ * Frames are copied into a small pool of PSRAM staging slots and the camera
+ * buffer is handed back to the driver straight away. A writer task drains
+ * the slots to the SD card, so capture never waits on fopen/fwrite/fclose.
+ */
+namespace WriteBehind {
+
+    /// @brief Tag used in ESP debug logs
+    static const char* TAG = "WRITE_BEHIND";
+
+    /// @brief What submit() does when every staging slot is waiting to be written
+    enum class Policy {
+        Block,      ///< Wait for the writer to free a slot (backpressure on capture)
+        DropNewest, ///< Discard the frame being submitted
+    };
+
+    /// @brief Configuration of the staging pool and writer task
+    struct Config {
+        size_t slot_count = 4;          ///< Number of frames that can wait to be written
+        size_t slot_size = 96 * 96 * 2; ///< Largest frame a slot can hold, in bytes
+        Policy policy = Policy::Block;
+        int core = 1;                   ///< Core to pin the writer task to
+        UBaseType_t priority = 3;       ///< FreeRTOS priority of the writer task
+    };
+
+    /// @brief Counters describing how well the card is keeping up
+    struct Stats {
+        uint32_t submitted;         ///< Frames accepted into a staging slot
+        uint32_t written;           ///< Frames written to the card
+        uint32_t dropped;           ///< Frames discarded by the drop policy or because they were too large
+        uint32_t write_errors;      ///< Frames the sink failed to write
+        uint32_t queue_depth;       ///< Frames currently waiting to be written
+        uint32_t max_queue_depth;   ///< Most frames that were ever waiting at once
+        uint64_t bytes_written;     ///< Pixel bytes written to the card
+        uint64_t write_time_us;     ///< Time the writer task spent writing
+        uint64_t stall_time_us;     ///< Time submit() spent blocked waiting for a free slot
+        uint32_t bytes_per_second;  ///< Write throughput while the writer was busy
+    };
+
+    /**
+     * @brief Allocate the staging slots and start the writer task
+     *
+     * @param sink - Open container the frames are appended to, must outlive stop()
+     * @param config - Size of the staging pool and the backpressure policy
+     * @return esp_err_t - ESP_OK if the writer task was started
+     */
+    esp_err_t start(Container::Writer& sink, const Config& config = Config());
+
+    /**
+     * @brief Write out every queued frame, then stop the writer task and free the slots
+     */
+    void stop();
+
+    /**
+     * @brief Copy a frame into a staging slot and queue it for writing
+     *
+     * @param data - The frame's pixel data
+     * @param length - Length of the pixel data in bytes
+     * @param width - Width of the frame in pixels
+     * @param height - Rows of the frame in data
+     * @param format - Pixel format of the frame
+     * @param timestamp_us - Capture time of the frame in microseconds
+     * @param first_row - Row of the full frame that data starts at
+     * @return esp_err_t - ESP_OK if the frame was queued, ESP_ERR_TIMEOUT if it was dropped
+     */
+    esp_err_t submit(const uint8_t* data, size_t length, uint16_t width, uint16_t height,
+                     uint16_t format, uint64_t timestamp_us, uint16_t first_row = 0);
+
+    /**
+     * @brief Get a snapshot of the writer counters
+     *
+     * @return Stats - The counters since the writer was started
+     */
+    Stats get_stats();
+}
@@ -0,0 +1,178 @@
+#include "aligned_writer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "esp_vfs_fat.h"
+
+esp_err_t AlignedWriter::open(const char* path, size_t preallocate)
+{
+    close();
+    stats_ = {};
+    used_ = 0;
+    flushed_ = 0;
+
+    if (!buffer_) {
+        // Internal DMA memory lets the SDMMC driver write straight from the buffer
+        buffer_ = static_cast<uint8_t*>(heap_caps_malloc(BUFFER_SIZE, MALLOC_CAP_DMA));
+        if (!buffer_) {
+            ESP_LOGE(TAG, "Failed to allocate %u byte write buffer", (unsigned)BUFFER_SIZE);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    // Reserve one contiguous extent so appends never have to search the FAT
+    if (preallocate > 0) {
+        esp_err_t err = esp_vfs_fat_create_contiguous_file(MOUNT_POINT, path, preallocate, true);
+        if (err == ESP_OK) {
+            fd_ = ::open(path, O_RDWR);
+        } else {
+            ESP_LOGW(TAG, "Failed to preallocate %u bytes for %s (%s)",
+                     (unsigned)preallocate, path, esp_err_to_name(err));
+        }
+    }
+
+    if (fd_ < 0) {
+        fd_ = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    }
+    if (fd_ < 0) {
+        ESP_LOGE(TAG, "Failed to open file for writing: %s", path);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+
+esp_err_t AlignedWriter::write_out(uint32_t offset, const uint8_t* data, size_t length)
+{
+    stats_.write_calls++;
+    stats_.device_bytes += length;
+    if (offset % SD_SECTOR_SIZE != 0 || length % SD_SECTOR_SIZE != 0) {
+        stats_.partial_sector_writes++;
+    }
+
+    if (lseek(fd_, offset, SEEK_SET) != static_cast<off_t>(offset)
+        || ::write(fd_, data, length) != static_cast<ssize_t>(length)) {
+        ESP_LOGE(TAG, "Failed to write %u bytes at offset %lu", (unsigned)length, (unsigned long)offset);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+
+esp_err_t AlignedWriter::flush_sectors()
+{
+    // Hand over the whole sectors and keep the partial one for later
+    const size_t whole = used_ - used_ % SD_SECTOR_SIZE;
+    if (whole == 0) {
+        return ESP_OK;
+    }
+
+    esp_err_t err = write_out(flushed_, buffer_, whole);
+    memmove(buffer_, buffer_ + whole, used_ - whole);
+    used_ -= whole;
+    flushed_ += whole;
+    return err;
+}
+
+
+esp_err_t AlignedWriter::write(const void* data, size_t length)
+{
+    if (fd_ < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    stats_.payload_bytes += length;
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    while (length > 0) {
+        const size_t chunk = std::min(length, BUFFER_SIZE - used_);
+        memcpy(buffer_ + used_, bytes, chunk);
+        used_ += chunk;
+        bytes += chunk;
+        length -= chunk;
+
+        if (used_ == BUFFER_SIZE && flush_sectors() != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+
+esp_err_t AlignedWriter::pad_to_sector()
+{
+    static const uint8_t zeros[256] = {};
+    size_t left = (SD_SECTOR_SIZE - position() % SD_SECTOR_SIZE) % SD_SECTOR_SIZE;
+    while (left > 0) {
+        const size_t chunk = std::min(left, sizeof(zeros));
+        const esp_err_t err = write(zeros, chunk);
+        if (err != ESP_OK) {
+            return err;
+        }
+        left -= chunk;
+    }
+    return ESP_OK;
+}
+
+
+esp_err_t AlignedWriter::rewrite_sector(uint32_t sector, const void* data)
+{
+    if (fd_ < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const uint32_t offset = sector * SD_SECTOR_SIZE;
+    if (offset >= flushed_) {
+        // Still in the buffer, so just patch it there
+        const size_t start = offset - flushed_;
+        if (start + SD_SECTOR_SIZE > used_) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        memcpy(buffer_ + start, data, SD_SECTOR_SIZE);
+        return ESP_OK;
+    }
+    return write_out(offset, static_cast<const uint8_t*>(data), SD_SECTOR_SIZE);
+}
+
+
+esp_err_t AlignedWriter::close()
+{
+    esp_err_t result = ESP_OK;
+    if (fd_ >= 0) {
+        if (flush_sectors() != ESP_OK) {
+            result = ESP_FAIL;
+        }
+
+        // The tail is the only write allowed to end mid-sector
+        if (used_ > 0 && write_out(flushed_, buffer_, used_) != ESP_OK) {
+            result = ESP_FAIL;
+        }
+        flushed_ += used_;
+        used_ = 0;
+
+        // Give back whatever part of a preallocated extent went unused
+        if (ftruncate(fd_, flushed_) != 0) {
+            ESP_LOGE(TAG, "Failed to truncate file to %lu bytes", (unsigned long)flushed_);
+            result = ESP_FAIL;
+        }
+        if (::close(fd_) != 0) {
+            result = ESP_FAIL;
+        }
+        fd_ = -1;
+
+        ESP_LOGI(TAG, "Wrote %llu payload bytes in %lu writes, %lu partial sectors, amplification %lu.%02lu",
+                 (unsigned long long)stats_.payload_bytes, (unsigned long)stats_.write_calls,
+                 (unsigned long)stats_.partial_sector_writes,
+                 (unsigned long)(write_amplification() >> 8),
+                 (unsigned long)((write_amplification() & 0xFF) * 100 >> 8));
+    }
+
+    if (buffer_) {
+        heap_caps_free(buffer_);
+        buffer_ = nullptr;
+    }
+    return result;
+}
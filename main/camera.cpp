@@ -2,10 +2,18 @@
 
 #include <esp_log.h>
 #include "constants.hpp"
+#include "deferred_log.hpp"
+#include "profile.hpp"
 #include "esp_camera.h"
 #include "sdcard.hpp"
+#include "write_behind.hpp"
 
-void Camera::config_cam() {        
+namespace {
+    // First row of each frame that is kept, see set_row_window()
+    int first_row = 0;
+}
+
+void Camera::config_cam(size_t fb_count) {        
     camera_config_t config;
     config.ledc_channel = LEDC_CHANNEL_0;
     config.ledc_timer = LEDC_TIMER_0;
@@ -31,7 +39,12 @@ void Camera::config_cam() {
     // Set frame size to 96x96
     config.frame_size = FRAMESIZE_96X96;
     config.jpeg_quality = 12;  // JPEG quality (lower is better)
-    config.fb_count = 1;  // Only one frame buffer
+    config.fb_count = fb_count;
+    config.fb_location = CAMERA_FB_IN_PSRAM;
+
+    // A single buffer is only refilled on request. With several buffers the
+    // driver keeps overwriting the oldest one so the newest frame is ready.
+    config.grab_mode = (fb_count > 1) ? CAMERA_GRAB_LATEST : CAMERA_GRAB_WHEN_EMPTY;
 
     // Initialize the camera
     esp_err_t err = esp_camera_init(&config);
@@ -44,91 +57,129 @@ void Camera::config_cam() {
 }
 
 
+void Camera::set_row_window(int row)
+{
+    first_row = row < 0 ? 0 : row;
+    ESP_LOGI(TAG, "Keeping rows %d and below of each frame", first_row);
+}
+
+
+int Camera::row_window()
+{
+    return first_row;
+}
+
+
+Vision::Frame Camera::vision_frame(const FrameHandle& frame)
+{
+    const int row = first_row < frame.height() ? first_row : frame.height();
+    const uint8_t* band = frame.data() + 2 * row * frame.width();
+    return Vision::Frame{band, frame.width(), frame.height(), row};
+}
+
+
+void Camera::FrameHandle::reset(camera_fb_t* fb)
+{
+    if (fb_ && fb_ != fb) {
+        esp_camera_fb_return(fb_);
+    }
+    fb_ = fb;
+}
+
+
 esp_err_t Camera::get_frame()
 {
-    auto pic = esp_camera_fb_get();
-    if (!pic) {
+    FrameHandle frame(esp_camera_fb_get());
+    if (!frame) {
         ESP_LOGE(TAG, "Camera capture failed");
         return ESP_FAIL;
     }
-    esp_camera_fb_return(pic);
     return ESP_OK;
 }
 
 
-esp_err_t Camera::get_frame(cv::Mat& image) 
+esp_err_t Camera::get_frame(FrameHandle& frame)
 {
-    // Capture a picture
-    auto* fb = esp_camera_fb_get();
-    if (!fb) {
+    {
+        PROFILE_SCOPE(FrameGet);
+        frame.reset(esp_camera_fb_get());
+    }
+    if (!frame) {
         ESP_LOGE(TAG, "Camera capture failed");
         return ESP_FAIL;
     }
 
     // Ensure the format is RGB565
-    if (fb->format != PIXFORMAT_RGB565) {
+    if (frame.format() != PIXFORMAT_RGB565) {
         ESP_LOGE(TAG, "Unsupported format. Expected RGB565.");
-        esp_camera_fb_return(fb);
+        frame.reset();
         return ESP_FAIL;
     }
 
-    int width = fb->width;
-    int height = fb->height;
+    return ESP_OK;
+}
+
 
-    // Create an OpenCV Mat with type CV_8UC2 (8-bit, 2 channels per pixel)
-    image.create(height, width, CV_8UC2);
+#ifndef CAMERA_NO_OPENCV
+esp_err_t Camera::get_frame(cv::Mat& image) 
+{
+    // Capture a picture
+    FrameHandle frame;
+    esp_err_t err = get_frame(frame);
+    if (err != ESP_OK) {
+        return err;
+    }
 
-    // Copy the RGB565 data directly into the OpenCV Mat
-    memcpy(image.data, fb->buf, fb->len);
+    // Create an OpenCV Mat with type CV_8UC2 (8-bit, 2 channels per pixel)
+    image.create(frame.height(), frame.width(), CV_8UC2);
 
-    // Release the frame buffer
-    esp_camera_fb_return(fb);
+    // Copy the RGB565 data directly into the OpenCV Mat. The frame buffer is
+    // released when the handle goes out of scope.
+    memcpy(image.data, frame.data(), frame.size());
 
-    ESP_LOGI(TAG, "Image captured and stored as CV_8UC2 (RGB565)");
+    DLOGI(TAG, "Image captured and stored as CV_8UC2 (RGB565)");
     return ESP_OK;
 }
 
 
 esp_err_t Camera::capture_and_save_image() {
-    cv::Mat frame = cv::Mat::zeros(96, 96, CV_8UC2);
-    get_frame(frame);
+    // View the frame in place rather than copying it into a new matrix
+    FrameHandle frame;
+    if (get_frame(frame) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    cv::Mat image = frame.mat();
 
     // Get the next available filename
     char filename[32];
     SDCard::get_next_filename(filename);
 
-    // Open file for writing
-    FILE *file = fopen(filename, "w");
-    if (!file) {
-        ESP_LOGE(TAG, "Failed to open file for writing: %s", filename);
-        return ESP_FAIL;
-    }
+    {
+        PROFILE_SCOPE(FileWrite);
 
-    // Write image data to file
-    fwrite(frame.data, 1, frame.total() * frame.elemSize(), file);
-    
-    // // Iterate over each pixel in the matrix
-    // for (int i = 0; i < frame.rows; ++i) {
-    //     for (int j = 0; j < frame.cols; ++j) {
-    //         cv::Vec2b vecpixel = frame.at<cv::Vec2b>(i, j);
-    //         uint16_t pixel = (static_cast<uint16_t>(vecpixel[0]) << 8) | vecpixel[1];
-    //         fprintf(file, "%d ", pixel);
-    //     }
-    //     fprintf(file, "\n");
-    // }
-
-    // fclose(file);
-    ESP_LOGI(TAG, "Image saved as: %s", filename);
+        // Open file for writing
+        FILE *file = fopen(filename, "w");
+        if (!file) {
+            ESP_LOGE(TAG, "Failed to open file for writing: %s", filename);
+            return ESP_FAIL;
+        }
+
+        // Write image data to file
+        fwrite(image.data, 1, image.total() * image.elemSize(), file);
+        fclose(file);
+    }
+    DLOGI(TAG, "Image saved as: %s", filename);
 
     return ESP_OK;
 }
+#endif
 
 
 esp_err_t Camera::capture_and_save_image_nocv() {
-    // Capture a picture
-    camera_fb_t *pic = esp_camera_fb_get();
-    if (!pic) {
-        ESP_LOGE(TAG, "Camera capture failed");
+    // Capture a picture. The whole frame is saved whatever the row window,
+    // since an IMAGE{n}.BIN has no header to record where a band starts.
+    FrameHandle pic;
+    if (get_frame(pic) != ESP_OK) {
         return ESP_FAIL;
     }
 
@@ -136,21 +187,54 @@ esp_err_t Camera::capture_and_save_image_nocv() {
     char filename[32];
     SDCard::get_next_filename(filename);
 
-    // Open file for writing
-    FILE *file = fopen(filename, "wb");
-    if (!file) {
-        ESP_LOGE(TAG, "Failed to open file for writing: %s", filename);
-        esp_camera_fb_return(pic);
+    {
+        PROFILE_SCOPE(FileWrite);
+
+        // Open file for writing
+        FILE *file = fopen(filename, "wb");
+        if (!file) {
+            ESP_LOGE(TAG, "Failed to open file for writing: %s", filename);
+            return ESP_FAIL;
+        }
+
+        // Write image data to file. The frame buffer goes back to the driver
+        // for reuse when the handle goes out of scope.
+        fwrite(pic.data(), 1, pic.size(), file);
+        fclose(file);
+    }
+    DLOGI(TAG, "Image saved as: %s", filename);
+
+    return ESP_OK;
+}
+
+
+esp_err_t Camera::capture_and_append(Container::Writer& writer) {
+    FrameHandle frame;
+    if (get_frame(frame) != ESP_OK) {
         return ESP_FAIL;
     }
 
-    // Write image data to file
-    fwrite(pic->buf, 1, pic->len, file);
-    fclose(file);
-    ESP_LOGI(TAG, "Image saved as: %s", filename);
+    const timeval& ts = frame.get()->timestamp;
+    const uint64_t timestamp_us = static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_usec;
+    const Vision::Frame band = vision_frame(frame);
+    const int rows = band.height - band.y0;
+    PROFILE_SCOPE(Append);
+    return writer.append(band.data, 2 * rows * band.width, band.width, rows,
+                         frame.format(), timestamp_us, band.y0);
+}
 
-    // Return the frame buffer back to the driver for reuse
-    esp_camera_fb_return(pic);
 
-    return ESP_OK;
+esp_err_t Camera::capture_and_queue() {
+    FrameHandle frame;
+    if (get_frame(frame) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    const timeval& ts = frame.get()->timestamp;
+    const uint64_t timestamp_us = static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_usec;
+    const Vision::Frame band = vision_frame(frame);
+    const int rows = band.height - band.y0;
+    PROFILE_SCOPE(Queue);
+    return WriteBehind::submit(band.data, 2 * rows * band.width, band.width, rows,
+                               frame.format(), timestamp_us, band.y0);
 }
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "capture.hpp"
+
+#include <atomic>
+#include <esp_log.h>
+#include "esp_camera.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+namespace {
+    // The newest captured frame not yet taken by the consumer, or nullptr
+    std::atomic<camera_fb_t*> latest{nullptr};
+
+    TaskHandle_t capture_task = nullptr;
+    SemaphoreHandle_t frame_ready = nullptr;
+    SemaphoreHandle_t task_done = nullptr;
+    std::atomic<bool> running{false};
+
+    std::atomic<uint32_t> captured{0};
+    std::atomic<uint32_t> overwritten{0};
+    std::atomic<uint32_t> failed{0};
+
+    void capture_loop(void*)
+    {
+        while (running.load(std::memory_order_acquire)) {
+            camera_fb_t* fb = esp_camera_fb_get();
+            if (!fb) {
+                failed.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            captured.fetch_add(1, std::memory_order_relaxed);
+
+            // Publish the new frame and hand the one it replaces back to the
+            // driver, so a slow consumer never gets a stale frame and the
+            // driver always has a buffer to fill
+            camera_fb_t* older = latest.exchange(fb, std::memory_order_acq_rel);
+            if (older) {
+                esp_camera_fb_return(older);
+                overwritten.fetch_add(1, std::memory_order_relaxed);
+            }
+            xSemaphoreGive(frame_ready);
+        }
+
+        xSemaphoreGive(task_done);
+        vTaskDelete(nullptr);
+    }
+}
+
+
+esp_err_t Capture::start(int core, UBaseType_t priority)
+{
+    if (running.load()) {
+        ESP_LOGE(TAG, "Capture task already running");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (!frame_ready) {
+        frame_ready = xSemaphoreCreateBinary();
+        task_done = xSemaphoreCreateBinary();
+        if (!frame_ready || !task_done) {
+            ESP_LOGE(TAG, "Failed to create capture semaphores");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    captured = 0;
+    overwritten = 0;
+    failed = 0;
+    running = true;
+
+    if (xTaskCreatePinnedToCore(capture_loop, "capture", 4096, nullptr, priority,
+                                &capture_task, core) != pdPASS) {
+        running = false;
+        ESP_LOGE(TAG, "Failed to create capture task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Capture task started on core %d", core);
+    return ESP_OK;
+}
+
+
+void Capture::stop()
+{
+    if (!running.exchange(false)) {
+        return;
+    }
+
+    // The task finishes the capture it is blocked in before it sees the flag
+    xSemaphoreTake(task_done, portMAX_DELAY);
+    capture_task = nullptr;
+
+    camera_fb_t* fb = latest.exchange(nullptr, std::memory_order_acq_rel);
+    if (fb) {
+        esp_camera_fb_return(fb);
+    }
+    // Nothing is waiting any more, so the next start() must not see a stale signal
+    xSemaphoreTake(frame_ready, 0);
+
+    const Stats stats = get_stats();
+    ESP_LOGI(TAG, "Capture task stopped: %lu captured, %lu overwritten, %lu failed",
+             (unsigned long)stats.captured, (unsigned long)stats.overwritten, (unsigned long)stats.failed);
+}
+
+
+esp_err_t Capture::take_latest(Camera::FrameHandle& frame, TickType_t timeout)
+{
+    if (!frame_ready) {
+        ESP_LOGE(TAG, "Capture task was never started");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // The producer has already replaced anything older, so whatever is here is the newest frame
+    camera_fb_t* fb;
+    while (!(fb = latest.exchange(nullptr, std::memory_order_acq_rel))) {
+        if (xSemaphoreTake(frame_ready, timeout) != pdTRUE) {
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+
+    frame.reset(fb);
+    return ESP_OK;
+}
+
+
+Capture::Stats Capture::get_stats()
+{
+    return Stats{
+        captured.load(std::memory_order_relaxed),
+        overwritten.load(std::memory_order_relaxed),
+        failed.load(std::memory_order_relaxed),
+    };
+}
@@ -0,0 +1,109 @@
+#include "class_lut.hpp"
+
+#include <cstring>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+namespace {
+    // Generated by the compiler, so it lands in flash with the rest of .rodata
+    constexpr ClassLut::Table FLASH_TABLE = ClassLut::generate();
+
+    ClassLut::Placement current = ClassLut::Placement::Flash;
+    const uint8_t* active = FLASH_TABLE.bits;
+    uint8_t* copy = nullptr;
+
+    const char* placement_name(ClassLut::Placement placement)
+    {
+        switch (placement) {
+            case ClassLut::Placement::InternalRam: return "internal RAM";
+            case ClassLut::Placement::Psram: return "PSRAM";
+            default: return "flash";
+        }
+    }
+
+    // Classify a pseudo-random sequence of codes so the cache cannot just
+    // hold a handful of lines, and return the nanoseconds per pixel
+    template <typename Classify>
+    uint32_t time_lookups(Classify classify)
+    {
+        constexpr uint32_t LOOKUPS = 96 * 96 * 4;
+        uint32_t code = 1;
+        uint32_t sink = 0;
+
+        const int64_t start = esp_timer_get_time();
+        for (uint32_t i = 0; i < LOOKUPS; i++) {
+            code = code * 1103515245 + 12345;
+            sink += classify(static_cast<uint16_t>(code >> 16));
+        }
+        const int64_t elapsed = esp_timer_get_time() - start;
+
+        // Keep the loop from being optimised away
+        volatile uint32_t keep = sink;
+        (void)keep;
+        return elapsed * 1000 / LOOKUPS;
+    }
+}
+
+
+esp_err_t ClassLut::init(Placement placement)
+{
+    if (copy) {
+        heap_caps_free(copy);
+        copy = nullptr;
+    }
+    current = Placement::Flash;
+    active = FLASH_TABLE.bits;
+
+    if (placement == Placement::Flash) {
+        return ESP_OK;
+    }
+
+    const uint32_t caps = placement == Placement::InternalRam
+        ? MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT
+        : MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+    copy = static_cast<uint8_t*>(heap_caps_malloc(SIZE, caps));
+    if (!copy) {
+        ESP_LOGE(TAG, "Failed to allocate the table in %s, using flash", placement_name(placement));
+        return ESP_ERR_NO_MEM;
+    }
+
+    memcpy(copy, FLASH_TABLE.bits, SIZE);
+    current = placement;
+    active = copy;
+    return ESP_OK;
+}
+
+
+ClassLut::Placement ClassLut::placement()
+{
+    return current;
+}
+
+
+const uint8_t* ClassLut::table()
+{
+    return active;
+}
+
+
+void ClassLut::log_report()
+{
+    const Placement restore = current;
+
+    ESP_LOGI(TAG, "arithmetic: 0 bytes, %lu ns/px",
+             (unsigned long)time_lookups([](uint16_t code) { return Vision::classify(code); }));
+
+    constexpr Placement PLACEMENTS[] = {Placement::Flash, Placement::InternalRam, Placement::Psram};
+    for (Placement placement : PLACEMENTS) {
+        if (init(placement) != ESP_OK) {
+            ESP_LOGI(TAG, "%s: unavailable", placement_name(placement));
+            continue;
+        }
+        const uint8_t* lut = active;
+        ESP_LOGI(TAG, "%s: %u bytes, %lu ns/px", placement_name(placement), (unsigned)SIZE,
+                 (unsigned long)time_lookups([lut](uint16_t code) { return lut[code]; }));
+    }
+
+    init(restore);
+}
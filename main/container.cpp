@@ -0,0 +1,219 @@
+#include "container.hpp"
+
+#include <cstring>
+#include <esp_log.h>
+#include "constants.hpp"
+
+namespace {
+    bool read_all(FILE* file, void* data, size_t length)
+    {
+        return fread(data, 1, length, file) == length;
+    }
+}
+
+
+esp_err_t Container::Writer::open(const char* path, size_t preallocate, bool pad_frames)
+{
+    close();
+    offsets_.clear();
+    pad_frames_ = pad_frames;
+
+    esp_err_t err = file_.open(path, preallocate);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open container for writing: %s", path);
+        return err;
+    }
+
+    // The header is written again on close, so give it a sector of its own
+    uint8_t sector[SD_SECTOR_SIZE] = {};
+    FileHeader* header = reinterpret_cast<FileHeader*>(sector);
+    memcpy(header->magic, FILE_MAGIC, sizeof(header->magic));
+    header->version = FORMAT_VERSION;
+    header->header_size = SD_SECTOR_SIZE;
+    return file_.write(sector, sizeof(sector));
+}
+
+
+esp_err_t Container::Writer::append(const uint8_t* data, uint32_t length, uint16_t width,
+                                    uint16_t height, uint16_t format, uint64_t timestamp_us,
+                                    uint16_t first_row)
+{
+    if (!file_.is_open()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    FrameHeader header = {};
+    header.magic = FRAME_MAGIC;
+    header.frame_id = frame_count();
+    header.timestamp_us = timestamp_us;
+    header.format = format;
+    header.width = width;
+    header.height = height;
+    header.first_row = first_row;
+    header.length = length;
+    if (pad_frames_) {
+        const uint32_t size = sizeof(header) + length;
+        header.padding = (SD_SECTOR_SIZE - size % SD_SECTOR_SIZE) % SD_SECTOR_SIZE;
+    }
+
+    const uint32_t offset = file_.position();
+    if (file_.write(&header, sizeof(header)) != ESP_OK || file_.write(data, length) != ESP_OK
+        || (pad_frames_ && file_.pad_to_sector() != ESP_OK)) {
+        ESP_LOGE(TAG, "Failed to append frame %lu", (unsigned long)header.frame_id);
+        return ESP_FAIL;
+    }
+
+    offsets_.push_back(offset);
+    return ESP_OK;
+}
+
+
+esp_err_t Container::Writer::close()
+{
+    if (!file_.is_open()) {
+        return ESP_OK;
+    }
+
+    esp_err_t result = ESP_OK;
+    const uint32_t index_offset = file_.position();
+
+    IndexHeader index = {INDEX_MAGIC, frame_count()};
+    if (file_.write(&index, sizeof(index)) != ESP_OK
+        || file_.write(offsets_.data(), offsets_.size() * sizeof(uint32_t)) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write container index");
+        result = ESP_FAIL;
+    }
+
+    // Only point the header at the index once the index is fully written
+    if (result == ESP_OK) {
+        uint8_t sector[SD_SECTOR_SIZE] = {};
+        FileHeader* header = reinterpret_cast<FileHeader*>(sector);
+        memcpy(header->magic, FILE_MAGIC, sizeof(header->magic));
+        header->version = FORMAT_VERSION;
+        header->header_size = SD_SECTOR_SIZE;
+        header->frame_count = frame_count();
+        header->index_offset = index_offset;
+
+        if (file_.rewrite_sector(0, sector) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to update container header");
+            result = ESP_FAIL;
+        }
+    }
+
+    if (file_.close() != ESP_OK) {
+        result = ESP_FAIL;
+    }
+    return result;
+}
+
+
+esp_err_t Container::Reader::open(const char* path)
+{
+    close();
+
+    file_ = fopen(path, "rb");
+    if (!file_) {
+        ESP_LOGE(TAG, "Failed to open container: %s", path);
+        return ESP_FAIL;
+    }
+
+    FileHeader header;
+    if (!read_all(file_, &header, sizeof(header))
+        || memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) != 0
+        || header.version != FORMAT_VERSION || header.header_size < sizeof(header)) {
+        ESP_LOGE(TAG, "Not a container file: %s", path);
+        close();
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (header.index_offset == 0 || load_index(header) != ESP_OK) {
+        ESP_LOGW(TAG, "Container has no index, scanning frames: %s", path);
+        scan_frames(header.header_size);
+        recovered_ = true;
+    }
+    return ESP_OK;
+}
+
+
+void Container::Reader::close()
+{
+    if (file_) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+    offsets_.clear();
+    cursor_ = 0;
+    recovered_ = false;
+}
+
+
+esp_err_t Container::Reader::load_index(const FileHeader& file_header)
+{
+    IndexHeader index;
+    if (fseek(file_, file_header.index_offset, SEEK_SET) != 0
+        || !read_all(file_, &index, sizeof(index))
+        || index.magic != INDEX_MAGIC || index.count != file_header.frame_count) {
+        return ESP_FAIL;
+    }
+
+    offsets_.resize(index.count);
+    if (!read_all(file_, offsets_.data(), offsets_.size() * sizeof(uint32_t))) {
+        offsets_.clear();
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+
+void Container::Reader::scan_frames(uint32_t start)
+{
+    offsets_.clear();
+    if (fseek(file_, 0, SEEK_END) != 0) {
+        return;
+    }
+    const long file_size = ftell(file_);
+
+    FrameHeader header;
+    uint32_t position = start;
+    while (fseek(file_, position, SEEK_SET) == 0
+           && read_all(file_, &header, sizeof(header))
+           && header.magic == FRAME_MAGIC && header.frame_id == offsets_.size()) {
+        // Stop at a frame whose data was cut short by the writer stopping
+        const uint32_t end = position + sizeof(header) + header.length + header.padding;
+        if (end > file_size) {
+            break;
+        }
+        offsets_.push_back(position);
+        position = end;
+    }
+}
+
+
+esp_err_t Container::Reader::read_frame(size_t index, FrameHeader& header, std::vector<uint8_t>& data)
+{
+    if (!file_ || index >= offsets_.size()) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (fseek(file_, offsets_[index], SEEK_SET) != 0
+        || !read_all(file_, &header, sizeof(header)) || header.magic != FRAME_MAGIC) {
+        ESP_LOGE(TAG, "Corrupt frame header at index %u", (unsigned)index);
+        return ESP_FAIL;
+    }
+
+    data.resize(header.length);
+    if (!read_all(file_, data.data(), header.length)) {
+        ESP_LOGE(TAG, "Truncated frame at index %u", (unsigned)index);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+
+esp_err_t Container::Reader::next(FrameHeader& header, std::vector<uint8_t>& data)
+{
+    if (cursor_ >= offsets_.size()) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return read_frame(cursor_++, header, data);
+}
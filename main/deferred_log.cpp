@@ -0,0 +1,241 @@
+#include "deferred_log.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include "esp_cpu.h"
+#include <esp_timer.h>
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "mpsc_ring.hpp"
+
+// Its address is written at the start of every log file, so the decoder can
+// relocate the format string addresses of a position independent host build
+extern "C" const char deferred_log_anchor[] = "DLOG";
+
+namespace {
+    MpscRing<DeferredLog::Record, DeferredLog::RING_SIZE> rings[portNUM_PROCESSORS];
+
+    FILE* file = nullptr;
+    DeferredLog::Config config;
+
+    TaskHandle_t flush_task = nullptr;
+    SemaphoreHandle_t wake = nullptr;
+    SemaphoreHandle_t flushed = nullptr;
+    SemaphoreHandle_t task_done = nullptr;
+
+    // Logging stops before the task does so its last drain catches everything
+    std::atomic<bool> logging{false};
+    std::atomic<bool> task_running{false};
+    std::atomic<bool> flush_requested{false};
+
+    std::atomic<uint32_t> logged{0};
+    std::atomic<uint32_t> dropped{0};
+    std::atomic<uint32_t> written{0};
+
+    template <typename V>
+    uint8_t* put(uint8_t* out, V value)
+    {
+        memcpy(out, &value, sizeof(value));
+        return out + sizeof(value);
+    }
+
+    // Fixed little-endian layout, with 64 bit addresses so host and device logs decode alike
+    void write_record(const DeferredLog::Record& record)
+    {
+        uint8_t buffer[8 + 8 + 4 + 1 + 1 + DeferredLog::ARG_BYTES];
+        uint8_t* out = buffer;
+        out = put(out, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(record.format)));
+        out = put(out, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(record.tag)));
+        out = put(out, record.timestamp_ms);
+        out = put(out, record.level);
+        out = put(out, record.length);
+        memcpy(out, record.args, record.length);
+        out += record.length;
+        fwrite(buffer, 1, out - buffer, file);
+    }
+
+    void drain()
+    {
+        uint32_t count = 0;
+        DeferredLog::Record record;
+        for (auto& ring : rings) {
+            while (ring.try_pop(record)) {
+                write_record(record);
+                count++;
+            }
+        }
+        if (count) {
+            fflush(file);
+            written.fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+
+    void flush_loop(void*)
+    {
+        while (task_running.load(std::memory_order_acquire)) {
+            xSemaphoreTake(wake, pdMS_TO_TICKS(config.flush_interval_ms));
+            drain();
+            if (flush_requested.exchange(false)) {
+                // Records logged before the request may have landed after the drain above
+                drain();
+                xSemaphoreGive(flushed);
+            }
+        }
+        drain();
+
+        xSemaphoreGive(task_done);
+        vTaskDelete(nullptr);
+    }
+}
+
+
+esp_err_t DeferredLog::start(const char* path, const Config& cfg)
+{
+    if (task_running.load()) {
+        ESP_LOGE(TAG, "Logger already running");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (!wake) {
+        wake = xSemaphoreCreateBinary();
+        flushed = xSemaphoreCreateBinary();
+        task_done = xSemaphoreCreateBinary();
+        if (!wake || !flushed || !task_done) {
+            ESP_LOGE(TAG, "Failed to create logger semaphores");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    file = fopen(path, "wb");
+    if (!file) {
+        ESP_LOGE(TAG, "Failed to open log file: %s", path);
+        return ESP_FAIL;
+    }
+    uint8_t header[sizeof(MAGIC) + 4 + 8];
+    uint8_t* out = header;
+    memcpy(out, MAGIC, sizeof(MAGIC));
+    out = put(out + sizeof(MAGIC), VERSION);
+    put(out, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(deferred_log_anchor)));
+    fwrite(header, 1, sizeof(header), file);
+
+    // Anything a late caller pushed after the last stop() belongs to the old file
+    Record stale;
+    for (auto& ring : rings) {
+        while (ring.try_pop(stale)) {
+        }
+    }
+
+    config = cfg;
+    logged = 0;
+    dropped = 0;
+    written = 0;
+    task_running = true;
+
+    if (xTaskCreatePinnedToCore(flush_loop, "log_flush", config.stack_size, nullptr, config.priority,
+                                &flush_task, config.core) != pdPASS) {
+        task_running = false;
+        fclose(file);
+        file = nullptr;
+        ESP_LOGE(TAG, "Failed to create flush task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    logging.store(true, std::memory_order_release);
+    ESP_LOGI(TAG, "Logging to %s", path);
+    return ESP_OK;
+}
+
+
+void DeferredLog::stop()
+{
+    if (!logging.exchange(false)) {
+        return;
+    }
+
+    task_running.store(false, std::memory_order_release);
+    xSemaphoreGive(wake);
+    xSemaphoreTake(task_done, portMAX_DELAY);
+    flush_task = nullptr;
+
+    fclose(file);
+    file = nullptr;
+
+    const Stats stats = get_stats();
+    ESP_LOGI(TAG, "Logger stopped: %lu logged, %lu written, %lu dropped",
+             (unsigned long)stats.logged, (unsigned long)stats.written, (unsigned long)stats.dropped);
+}
+
+
+esp_err_t DeferredLog::flush(TickType_t timeout)
+{
+    if (!running()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // Clear a give left over from an earlier flush that timed out
+    xSemaphoreTake(flushed, 0);
+    flush_requested.store(true);
+    xSemaphoreGive(wake);
+    return xSemaphoreTake(flushed, timeout) == pdTRUE ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+
+bool DeferredLog::running()
+{
+    return logging.load(std::memory_order_acquire);
+}
+
+
+DeferredLog::Stats DeferredLog::get_stats()
+{
+    return Stats{
+        logged.load(std::memory_order_relaxed),
+        dropped.load(std::memory_order_relaxed),
+        written.load(std::memory_order_relaxed),
+    };
+}
+
+
+void DeferredLog::push(const Record& record)
+{
+    if (rings[esp_cpu_get_core_id()].try_push(record)) {
+        logged.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+
+DeferredLog::Benchmark DeferredLog::log_benchmark(int calls)
+{
+    Benchmark result{};
+    if (!running() || calls <= 0) {
+        ESP_LOGE(TAG, "Start the logger before benchmarking it");
+        return result;
+    }
+    const char* filename = "IMAGE0.BIN";
+
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < calls; i++) {
+        ESP_LOGI(TAG, "Next filename: %s (%d)", filename, i);
+    }
+    const int64_t text_us = esp_timer_get_time() - start;
+
+    // Bursts that fit in the ring, so every timed call takes the normal path
+    int64_t deferred_us = 0;
+    for (int done = 0; done < calls;) {
+        const int burst = (calls - done) < static_cast<int>(RING_SIZE) ? (calls - done) : RING_SIZE;
+        start = esp_timer_get_time();
+        for (int i = done; i < done + burst; i++) {
+            DLOGI(TAG, "Next filename: %s (%d)", filename, i);
+        }
+        deferred_us += esp_timer_get_time() - start;
+        done += burst;
+        flush();
+    }
+
+    result.esp_log_ns = static_cast<uint32_t>(text_us * 1000 / calls);
+    result.deferred_ns = static_cast<uint32_t>(deferred_us * 1000 / calls);
+    ESP_LOGI(TAG, "ESP_LOGI: %lu ns/call, DLOGI: %lu ns/call over %d calls",
+             (unsigned long)result.esp_log_ns, (unsigned long)result.deferred_ns, calls);
+    return result;
+}
@@ -1,8 +1,11 @@
 // SD Card Imports
 #include "camera.hpp"
 #include "constants.hpp"
-#include "opencv2.hpp"
+#include "deferred_log.hpp"
+#include "profile.hpp"
 #include "sdcard.hpp"
+#include "sensor_state.hpp"
+#include "warmup.hpp"
 
 // Esp imports
 #include <esp_err.h>
@@ -18,24 +21,51 @@ void app_main(void);
 /// @brief The entry-point.
 void app_main(void)
 {
+    // Never throw away more frames than the old fixed warm-up did
     constexpr int THROWAWAY_IMG_COUNT = 10;
 
+    // The report at the end covers this boot only, even when app_main is run again on the host
+    Profile::reset();
+
     // Configure the camera
     Camera::config_cam();
 
+    // Start the sensor from where it settled on the last boot, if known
+    bool restored = false;
+    if (SensorState::init_nvs() == ESP_OK) {
+        restored = SensorState::restore(esp_camera_sensor_get()) == ESP_OK;
+    }
+
     if (SDCard::mount_sd_card() == ESP_OK) {
-        // Throw away some frames to reduce the yellow tint
-        for (int i = 0; i < THROWAWAY_IMG_COUNT; i++) {
-            auto res = Camera::get_frame();
-            ESP_LOGI(Camera::TAG, "Captured throwaway frame: %d", i);
+        // Per-frame messages go to a binary log on the card, see host/decode_log.py
+        DeferredLog::start(MOUNT_POINT "/LOG.BIN");
+
+        // Throw away frames until the yellow tint has settled. A restored
+        // sensor only needs to confirm it is already stable.
+        Warmup::Config warmup;
+        warmup.max_frames = THROWAWAY_IMG_COUNT;
+        if (restored) {
+            warmup.min_frames = 1;
+            warmup.stable_frames = 1;
         }
+        bool converged = false;
+        Warmup::run(warmup, &converged);
 
         // Capture and save a good image
         Camera::capture_and_save_image_nocv();
         ESP_LOGI(Camera::TAG, "Image captured and saved to SD card");
 
+        // Remember the settled state for the next boot
+        if (converged) {
+            SensorState::save(esp_camera_sensor_get());
+        }
+
         // Unmount the SD card
+        DeferredLog::stop();
         SDCard::unmount_sd_card();
+
+        // Stage timings, when built with profiling
+        Profile::log_report();
     } else {
         ESP_LOGE(SDCard::TAG, "Failed to mount SD card");
     }
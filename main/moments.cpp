@@ -0,0 +1,103 @@
+#include "moments.hpp"
+
+namespace {
+    constexpr int CORDIC_STEPS = 16;
+
+    // atan(2^-i) in radians, 16.16 fixed point
+    constexpr int32_t ATAN_Q16[CORDIC_STEPS] = {
+        51472, 30386, 16055, 8150, 4091, 2047, 1024, 512,
+        256, 128, 64, 32, 16, 8, 4, 2,
+    };
+
+    // pi in 16.16 fixed point
+    constexpr int32_t PI_Q16 = 205887;
+
+    // 1 / prod(sqrt(1 + 2^-2i)) in 2.14 fixed point, undoes the CORDIC gain
+    constexpr int32_t CORDIC_INV_GAIN_Q14 = 9949;
+
+    // Angle of (x, y) in 16.16 radians within (-pi, pi], by CORDIC vectoring
+    int32_t cordic_atan2(int64_t y, int64_t x)
+    {
+        if (x == 0 && y == 0) {
+            return 0;
+        }
+
+        // Normalise the larger component into [2^27, 2^28): small inputs
+        // would lose all their bits to the shifts, large ones would overflow
+        const auto magnitude = [](int64_t v) { return v < 0 ? -v : v; };
+        while (magnitude(x) >= (1 << 28) || magnitude(y) >= (1 << 28)) {
+            x /= 2;
+            y /= 2;
+        }
+        while (magnitude(x) < (1 << 27) && magnitude(y) < (1 << 27)) {
+            x *= 2;
+            y *= 2;
+        }
+
+        // Rotate into the right half plane, where vectoring converges
+        int32_t angle = 0;
+        int32_t cx = static_cast<int32_t>(x);
+        int32_t cy = static_cast<int32_t>(y);
+        if (cx < 0) {
+            angle = cy >= 0 ? PI_Q16 : -PI_Q16;
+            cx = -cx;
+            cy = -cy;
+        }
+
+        for (int i = 0; i < CORDIC_STEPS; i++) {
+            const int32_t nx = cy > 0 ? cx + (cy >> i) : cx - (cy >> i);
+            const int32_t ny = cy > 0 ? cy - (cx >> i) : cy + (cx >> i);
+            angle += cy > 0 ? ATAN_Q16[i] : -ATAN_Q16[i];
+            cx = nx;
+            cy = ny;
+        }
+        return angle;
+    }
+
+    // cos and sin of a 16.16 angle within [-pi/2, pi/2] in 2.14, by CORDIC rotation
+    void cordic_cos_sin(int32_t angle, int32_t& cos_q14, int32_t& sin_q14)
+    {
+        int32_t x = CORDIC_INV_GAIN_Q14;
+        int32_t y = 0;
+        for (int i = 0; i < CORDIC_STEPS; i++) {
+            const int32_t nx = angle >= 0 ? x - (y >> i) : x + (y >> i);
+            const int32_t ny = angle >= 0 ? y + (x >> i) : y - (x >> i);
+            angle -= angle >= 0 ? ATAN_Q16[i] : -ATAN_Q16[i];
+            x = nx;
+            y = ny;
+        }
+        cos_q14 = x;
+        sin_q14 = y;
+    }
+}
+
+
+Vision::LineFit Vision::fit_line(const Moments& m)
+{
+    LineFit line = {};
+    if (m.m00 == 0) {
+        return line;
+    }
+
+    line.x0_q8 = (static_cast<int64_t>(m.m10) << 8) / m.m00;
+    line.y0_q8 = (static_cast<int64_t>(m.m01) << 8) / m.m00;
+
+    // Central moments scaled by m00 so they stay integers; the common
+    // factor does not change the angle
+    const int64_t mu20 = static_cast<int64_t>(m.m00) * m.m20 - static_cast<int64_t>(m.m10) * m.m10;
+    const int64_t mu11 = static_cast<int64_t>(m.m00) * m.m11 - static_cast<int64_t>(m.m10) * m.m01;
+    const int64_t mu02 = static_cast<int64_t>(m.m00) * m.m02 - static_cast<int64_t>(m.m01) * m.m01;
+
+    int32_t angle = cordic_atan2(2 * mu11, mu20 - mu02) / 2;
+    if (angle <= -PI_Q16 / 2) {
+        angle += PI_Q16;
+    }
+    line.angle_q16 = angle;
+
+    int32_t cos_q14;
+    int32_t sin_q14;
+    cordic_cos_sin(angle, cos_q14, sin_q14);
+    line.vx_q14 = static_cast<int16_t>(cos_q14);
+    line.vy_q14 = static_cast<int16_t>(sin_q14);
+    return line;
+}
\ No newline at end of file
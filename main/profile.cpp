@@ -0,0 +1,145 @@
+#include "profile.hpp"
+
+#include <atomic>
+#include <esp_log.h>
+#include "esp_rom_sys.h"
+#include "freertos/FreeRTOS.h"
+
+namespace {
+    constexpr const char* STAGE_NAMES[] = {
+        "frame_get", "warmup", "file_name", "file_write", "append", "queue", "segment", "white_line",
+    };
+    static_assert(sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]) == Profile::STAGE_COUNT,
+                  "Every stage needs a name");
+
+#if PROFILE_ENABLED
+    // Everything starts at zero, so the minimum is kept inverted and both
+    // extremes are updated as maxima
+    struct Histogram {
+        std::atomic<uint32_t> buckets[Profile::BUCKET_COUNT];
+        std::atomic<uint32_t> total_low;
+        std::atomic<uint32_t> total_high;
+        std::atomic<uint32_t> inverted_min;
+        std::atomic<uint32_t> max;
+    };
+
+    Histogram histograms[portNUM_PROCESSORS][Profile::STAGE_COUNT];
+
+    void store_max(std::atomic<uint32_t>& target, uint32_t value)
+    {
+        uint32_t current = target.load(std::memory_order_relaxed);
+        while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+#endif
+}
+
+
+void Profile::record(Stage stage, uint32_t cycles)
+{
+#if PROFILE_ENABLED
+    Histogram& histogram = histograms[esp_cpu_get_core_id()][static_cast<size_t>(stage)];
+    histogram.buckets[bucket_of(cycles)].fetch_add(1, std::memory_order_relaxed);
+
+    // A 32 bit total wraps after a few seconds, so carry into a high word
+    const uint32_t low = histogram.total_low.fetch_add(cycles, std::memory_order_relaxed);
+    if (static_cast<uint32_t>(low + cycles) < low) {
+        histogram.total_high.fetch_add(1, std::memory_order_relaxed);
+    }
+    store_max(histogram.inverted_min, ~cycles);
+    store_max(histogram.max, cycles);
+#else
+    (void)stage;
+    (void)cycles;
+#endif
+}
+
+
+Profile::Summary Profile::summarize(Stage stage)
+{
+    Summary summary{};
+#if PROFILE_ENABLED
+    uint32_t counts[BUCKET_COUNT] = {};
+    uint32_t inverted_min = 0;
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        const Histogram& histogram = histograms[core][static_cast<size_t>(stage)];
+        for (size_t bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+            counts[bucket] += histogram.buckets[bucket].load(std::memory_order_relaxed);
+        }
+        summary.total += (static_cast<uint64_t>(histogram.total_high.load(std::memory_order_relaxed)) << 32) +
+                         histogram.total_low.load(std::memory_order_relaxed);
+        const uint32_t core_min = histogram.inverted_min.load(std::memory_order_relaxed);
+        inverted_min = core_min > inverted_min ? core_min : inverted_min;
+        const uint32_t core_max = histogram.max.load(std::memory_order_relaxed);
+        summary.max = core_max > summary.max ? core_max : summary.max;
+    }
+    for (size_t bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+        summary.count += counts[bucket];
+    }
+    if (summary.count == 0) {
+        return summary;
+    }
+    summary.min = ~inverted_min;
+
+    // The smallest bucket holding at least 99% of the scopes, reported by its middle
+    const uint32_t rank = summary.count - summary.count / 100;
+    uint32_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+        seen += counts[bucket];
+        if (seen >= rank) {
+            const uint64_t floor = bucket_floor(bucket);
+            const uint64_t ceiling = bucket + 1 < BUCKET_COUNT ? bucket_floor(bucket + 1) : (1ull << 32);
+            uint64_t p99 = (floor + ceiling - 1) / 2;
+            p99 = p99 < summary.min ? summary.min : p99;
+            p99 = p99 > summary.max ? summary.max : p99;
+            summary.p99 = static_cast<uint32_t>(p99);
+            break;
+        }
+    }
+#else
+    (void)stage;
+#endif
+    return summary;
+}
+
+
+void Profile::reset()
+{
+#if PROFILE_ENABLED
+    for (auto& core : histograms) {
+        for (Histogram& histogram : core) {
+            for (auto& bucket : histogram.buckets) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+            histogram.total_low.store(0, std::memory_order_relaxed);
+            histogram.total_high.store(0, std::memory_order_relaxed);
+            histogram.inverted_min.store(0, std::memory_order_relaxed);
+            histogram.max.store(0, std::memory_order_relaxed);
+        }
+    }
+#endif
+}
+
+
+void Profile::log_report()
+{
+#if PROFILE_ENABLED
+    const double cycles_per_us = esp_rom_get_cpu_ticks_per_us();
+    ESP_LOGI(TAG, "%-10s %8s %10s %10s %10s %10s", "stage", "count", "min us", "mean us", "p99 us", "max us");
+    for (size_t i = 0; i < STAGE_COUNT; i++) {
+        const Summary s = summarize(static_cast<Stage>(i));
+        if (s.count == 0) {
+            continue;
+        }
+        ESP_LOGI(TAG, "%-10s %8lu %10.1f %10.1f %10.1f %10.1f", STAGE_NAMES[i], (unsigned long)s.count,
+                 s.min / cycles_per_us, s.total / cycles_per_us / s.count, s.p99 / cycles_per_us,
+                 s.max / cycles_per_us);
+    }
+#endif
+}
+
+
+const char* Profile::stage_name(Stage stage)
+{
+    return STAGE_NAMES[static_cast<size_t>(stage)];
+}
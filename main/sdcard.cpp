@@ -2,6 +2,8 @@
 
 #include <exception>
 #include "constants.hpp"
+#include "deferred_log.hpp"
+#include "profile.hpp"
 #include "esp_vfs_fat.h"
 #include "sdmmc_cmd.h"
 #include "driver/sdmmc_host.h"
@@ -11,6 +13,48 @@
 #include <esp_spiffs.h>
 #include <esp_log.h>
 #include "sdkconfig.h"
+#include <cstring>
+#include <sys/stat.h>
+
+namespace {
+    // Number of the next image, or -1 before the counter has been loaded
+    int next_image_number = -1;
+
+    // Images handed out since the counter was last written to the card
+    int unsaved_images = 0;
+
+    void format_filename(char *filename, int number)
+    {
+        sprintf(filename, MOUNT_POINT "/" FILE_PREFIX "%d" FILE_EXTENSION, number);
+    }
+
+    // Find the number after the highest IMAGE{n}.BIN on the card
+    int scan_for_next_number()
+    {
+        DIR* dir = opendir(MOUNT_POINT);
+        if (!dir) {
+            return 0;
+        }
+
+        const size_t prefix_len = strlen(FILE_PREFIX);
+        int next = 0;
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            if (strncasecmp(entry->d_name, FILE_PREFIX, prefix_len) != 0) {
+                continue;
+            }
+
+            int number;
+            char extension[8];
+            if (sscanf(entry->d_name + prefix_len, "%d%7s", &number, extension) == 2
+                && strcasecmp(extension, FILE_EXTENSION) == 0 && number >= next) {
+                next = number + 1;
+            }
+        }
+        closedir(dir);
+        return next;
+    }
+}
 
 esp_err_t SDCard::mount_sd_card() 
 {
@@ -28,11 +72,10 @@ esp_err_t SDCard::mount_sd_card()
     gpio_set_pull_mode(GPIO_NUM_12, GPIO_PULLUP_ONLY);   // D2
     gpio_set_pull_mode(GPIO_NUM_13, GPIO_PULLUP_ONLY);   // D3
 
-    esp_vfs_fat_sdmmc_mount_config_t mount_config = {
-        .format_if_mount_failed = false,
-        .max_files = 5,
-        .allocation_unit_size = 16 * 1024
-    };
+    esp_vfs_fat_sdmmc_mount_config_t mount_config = {};
+    mount_config.format_if_mount_failed = false;
+    mount_config.max_files = 5;
+    mount_config.allocation_unit_size = SD_ALLOCATION_UNIT;
 
     sdmmc_card_t *card;
     esp_err_t ret = esp_vfs_fat_sdmmc_mount(MOUNT_POINT, &host, &slot_config, &mount_config, &card);
@@ -51,12 +94,17 @@ esp_err_t SDCard::mount_sd_card()
     // Card has been initialized, print its properties
     sdmmc_card_print_info(stdout, card);
     ESP_LOGI(TAG, "SD card mounted successfully.");
+
+    load_image_counter();
     return ESP_OK;
 }
 
 
 esp_err_t SDCard::unmount_sd_card()
 {
+    flush_image_counter();
+    next_image_number = -1;
+
     try {
         esp_vfs_fat_sdmmc_unmount();
         ESP_LOGI(TAG, "Unmounted SD Card");
@@ -68,29 +116,76 @@ esp_err_t SDCard::unmount_sd_card()
 }
 
 
-// Function to find the next available image filename
-void SDCard::get_next_filename(char *filename) {
-    int file_number = 0;
+int SDCard::load_image_counter()
+{
+    int file_number = -1;
     FILE* config_file = fopen(CONFIG_FILE, "r");
 
     if (config_file) {
-        if (fscanf(config_file, "%d", &file_number) != 1) {
+        if (fscanf(config_file, "%d", &file_number) != 1 || file_number < 0) {
             ESP_LOGE(TAG, "Failed to read file number from config file");
+            file_number = -1;
         }
         fclose(config_file);
     } else {
-        ESP_LOGI(TAG, "Config file not found, starting from 0");
+        ESP_LOGI(TAG, "Config file not found");
     }
 
-    sprintf(filename, MOUNT_POINT "/" FILE_PREFIX "%d" FILE_EXTENSION, file_number);
-    ESP_LOGI(TAG, "Next filename: %s", filename);
+    // A stored number is only trusted if its image has not been written yet
+    char filename[32];
+    struct stat st;
+    if (file_number >= 0) {
+        format_filename(filename, file_number);
+        if (stat(filename, &st) == 0) {
+            ESP_LOGW(TAG, "Stored file number %d is stale", file_number);
+            file_number = -1;
+        }
+    }
 
-    config_file = fopen(CONFIG_FILE, "w");
-    if (config_file) {
-        fprintf(config_file, "%d", file_number + 1);
-        fclose(config_file);
+    if (file_number < 0) {
+        file_number = scan_for_next_number();
+        ESP_LOGI(TAG, "Recovered file number %d from existing images", file_number);
+        unsaved_images = 1;
     } else {
+        unsaved_images = 0;
+    }
+
+    next_image_number = file_number;
+    return next_image_number;
+}
+
+
+esp_err_t SDCard::flush_image_counter()
+{
+    if (next_image_number < 0 || unsaved_images == 0) {
+        return ESP_OK;
+    }
+
+    FILE* config_file = fopen(CONFIG_FILE, "w");
+    if (!config_file) {
         ESP_LOGE(TAG, "Failed to open config file for writing");
+        return ESP_FAIL;
     }
 
+    fprintf(config_file, "%d", next_image_number);
+    fclose(config_file);
+    unsaved_images = 0;
+    return ESP_OK;
+}
+
+
+// Function to find the next available image filename
+void SDCard::get_next_filename(char *filename) {
+    PROFILE_SCOPE(FileName);
+    if (next_image_number < 0) {
+        load_image_counter();
+    }
+
+    format_filename(filename, next_image_number);
+    next_image_number++;
+    DLOGI(TAG, "Next filename: %s", filename);
+
+    if (++unsaved_images >= COUNTER_PERSIST_INTERVAL) {
+        flush_image_counter();
+    }
 }
\ No newline at end of file
@@ -0,0 +1,276 @@
+#include "sensor_state.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <esp_log.h>
+#include "nvs.h"
+#include "nvs_flash.h"
+
+namespace {
+    // Bump when the snapshot layout or register tables change
+    constexpr uint16_t SNAPSHOT_VERSION = 1;
+    constexpr size_t MAX_REGS = 16;
+
+    struct Reg {
+        int addr;
+        int mask;
+    };
+
+    // OV2640: bit 8 of the address selects the sensor register bank. The
+    // OV2640 keeps its white balance gains inside the DSP with no documented
+    // registers, so only exposure and gain are captured for it.
+    constexpr Reg OV2640_REGS[] = {
+        {0x100, 0xFF},  // GAIN: AGC gain
+        {0x104, 0x03},  // REG04: AEC[1:0]
+        {0x110, 0xFF},  // AEC: AEC[9:2]
+        {0x145, 0x3F},  // REG45: AEC[15:10]
+    };
+
+    // OV3660 and OV5640 share the same AWB and AEC/AGC register map
+    constexpr Reg OV3660_REGS[] = {
+        {0x3400, 0x0F}, {0x3401, 0xFF},  // AWB red gain
+        {0x3402, 0x0F}, {0x3403, 0xFF},  // AWB green gain
+        {0x3404, 0x0F}, {0x3405, 0xFF},  // AWB blue gain
+        {0x3500, 0x0F}, {0x3501, 0xFF}, {0x3502, 0xFF},  // AEC exposure
+        {0x350A, 0x03}, {0x350B, 0xFF},  // AGC real gain
+    };
+
+    // Auto-control bits to switch to manual while the snapshot is written, so
+    // the sensor latches the stored values instead of its own loops
+    // overwriting them. The previous modes are put back afterwards and the
+    // loops carry on from the written values.
+    struct ModeReg {
+        int addr;
+        int mask;
+        int manual;
+    };
+
+    constexpr ModeReg OV2640_MODES[] = {
+        {0x113, 0x05, 0x00},    // COM8: AEC (bit 0) and AGC (bit 2) off
+    };
+
+    // The AWB gains in 0x3400-0x3405 are ignored unless AWB is manual
+    constexpr ModeReg OV3660_MODES[] = {
+        {0x3406, 0x01, 0x01},   // AWB manual control
+        {0x3503, 0x03, 0x03},   // AEC (bit 0) and AGC (bit 1) manual
+    };
+
+    struct Snapshot {
+        uint16_t version;
+        uint16_t pid;
+        uint8_t count;
+        uint8_t values[MAX_REGS];
+    };
+
+    template <size_t N>
+    constexpr size_t table_size(const Reg (&)[N]) { return N; }
+
+    static_assert(table_size(OV2640_REGS) <= MAX_REGS, "OV2640 register table too large");
+    static_assert(table_size(OV3660_REGS) <= MAX_REGS, "OV3660 register table too large");
+
+    template <size_t N>
+    constexpr size_t table_size(const ModeReg (&)[N]) { return N; }
+
+    constexpr size_t MAX_MODES = 2;
+
+    /// Pick the register table for a sensor, or nullptr if it is not supported
+    const Reg* regs_for(uint16_t pid, size_t& count)
+    {
+        switch (pid) {
+            case OV2640_PID:
+                count = table_size(OV2640_REGS);
+                return OV2640_REGS;
+            case OV3660_PID:
+            case OV5640_PID:
+                count = table_size(OV3660_REGS);
+                return OV3660_REGS;
+            default:
+                count = 0;
+                return nullptr;
+        }
+    }
+
+    /// Pick the auto-control registers of a sensor, matching regs_for()
+    const ModeReg* modes_for(uint16_t pid, size_t& count)
+    {
+        switch (pid) {
+            case OV2640_PID:
+                count = table_size(OV2640_MODES);
+                return OV2640_MODES;
+            case OV3660_PID:
+            case OV5640_PID:
+                count = table_size(OV3660_MODES);
+                return OV3660_MODES;
+            default:
+                count = 0;
+                return nullptr;
+        }
+    }
+
+    /// Write the register values of a snapshot with the auto loops held in manual mode
+    esp_err_t write_regs(sensor_t* sensor, const Reg* regs, size_t count, const uint8_t* values)
+    {
+        size_t mode_count;
+        const ModeReg* modes = modes_for(sensor->id.PID, mode_count);
+        int saved_modes[MAX_MODES];
+        for (size_t i = 0; i < mode_count; i++) {
+            saved_modes[i] = sensor->get_reg(sensor, modes[i].addr, modes[i].mask);
+            if (saved_modes[i] < 0
+                    || sensor->set_reg(sensor, modes[i].addr, modes[i].mask, modes[i].manual) != 0) {
+                ESP_LOGE(SensorState::TAG, "Failed to switch sensor register 0x%x to manual", modes[i].addr);
+                return ESP_FAIL;
+            }
+        }
+
+        esp_err_t err = ESP_OK;
+        for (size_t i = 0; i < count; i++) {
+            if (sensor->set_reg(sensor, regs[i].addr, regs[i].mask, values[i]) != 0) {
+                ESP_LOGE(SensorState::TAG, "Failed to write sensor register 0x%x", regs[i].addr);
+                err = ESP_FAIL;
+                break;
+            }
+        }
+
+        // Hand control back even if a write failed
+        for (size_t i = 0; i < mode_count; i++) {
+            if (sensor->set_reg(sensor, modes[i].addr, modes[i].mask, saved_modes[i]) != 0) {
+                ESP_LOGE(SensorState::TAG, "Failed to restore sensor register 0x%x", modes[i].addr);
+                err = ESP_FAIL;
+            }
+        }
+        return err;
+    }
+}
+
+
+esp_err_t SensorState::init_nvs()
+{
+    esp_err_t err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_LOGW(TAG, "NVS partition needs to be erased");
+        err = nvs_flash_erase();
+        if (err == ESP_OK) {
+            err = nvs_flash_init();
+        }
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize NVS (%s)", esp_err_to_name(err));
+    }
+    return err;
+}
+
+
+esp_err_t SensorState::save(sensor_t* sensor)
+{
+    if (!sensor || !sensor->get_reg) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t count;
+    const Reg* regs = regs_for(sensor->id.PID, count);
+    if (!regs) {
+        ESP_LOGW(TAG, "No register table for sensor 0x%x", sensor->id.PID);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    Snapshot snapshot = {};
+    snapshot.version = SNAPSHOT_VERSION;
+    snapshot.pid = sensor->id.PID;
+    snapshot.count = count;
+    for (size_t i = 0; i < count; i++) {
+        const int value = sensor->get_reg(sensor, regs[i].addr, regs[i].mask);
+        if (value < 0) {
+            ESP_LOGE(TAG, "Failed to read sensor register 0x%x", regs[i].addr);
+            return ESP_FAIL;
+        }
+        snapshot.values[i] = value;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS (%s)", esp_err_to_name(err));
+        return err;
+    }
+
+    // Saving on every boot would wear the flash for nothing once the scene is stable
+    Snapshot stored = {};
+    size_t length = sizeof(stored);
+    if (nvs_get_blob(handle, NVS_KEY, &stored, &length) == ESP_OK
+            && length == sizeof(stored) && memcmp(&stored, &snapshot, sizeof(snapshot)) == 0) {
+        nvs_close(handle);
+        ESP_LOGI(TAG, "Sensor state unchanged, not rewriting NVS");
+        return ESP_OK;
+    }
+
+    err = nvs_set_blob(handle, NVS_KEY, &snapshot, sizeof(snapshot));
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to store sensor state (%s)", esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "Stored %d sensor registers", snapshot.count);
+    return ESP_OK;
+}
+
+
+esp_err_t SensorState::restore(sensor_t* sensor)
+{
+    if (!sensor || !sensor->get_reg || !sensor->set_reg) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        // The namespace does not exist until the first snapshot is saved
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    Snapshot snapshot = {};
+    size_t length = sizeof(snapshot);
+    err = nvs_get_blob(handle, NVS_KEY, &snapshot, &length);
+    nvs_close(handle);
+    if (err != ESP_OK || length != sizeof(snapshot)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    size_t count;
+    const Reg* regs = regs_for(sensor->id.PID, count);
+    if (!regs || snapshot.version != SNAPSHOT_VERSION
+              || snapshot.pid != sensor->id.PID || snapshot.count != count) {
+        ESP_LOGW(TAG, "Stored sensor state does not match this sensor, ignoring it");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    err = write_regs(sensor, regs, count, snapshot.values);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    ESP_LOGI(TAG, "Restored %d sensor registers", snapshot.count);
+    return ESP_OK;
+}
+
+
+esp_err_t SensorState::clear()
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = nvs_erase_key(handle, NVS_KEY);
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    } else if (err == ESP_ERR_NVS_NOT_FOUND) {
+        err = ESP_OK;
+    }
+    nvs_close(handle);
+    return err;
+}
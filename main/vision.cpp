@@ -0,0 +1,238 @@
+#include "vision.hpp"
+
+#include <cstring>
+#include "profile.hpp"
+#include "swar.hpp"
+
+Vision::BoxResult Vision::detect_stop_box(const Frame& frame, bool early_exit)
+{
+    return count_in_box(frame, STOPBOX, PERCENT_TO_STOP, early_exit, is_red);
+}
+
+
+Vision::BoxResult Vision::detect_car_box(const Frame& frame, bool early_exit)
+{
+    return count_in_box(frame, CARBOX, PERCENT_TO_CAR, early_exit, is_green);
+}
+
+
+void Vision::segment(const Frame& frame, Segmentation& out, const uint8_t* lut, Integrals* integrals)
+{
+    PROFILE_SCOPE(Segment);
+    const int width = frame.width < MAX_WIDTH ? frame.width : MAX_WIDTH;
+    const int height = frame.height < MAX_HEIGHT ? frame.height : MAX_HEIGHT;
+    out.width = width;
+    out.height = height;
+    out.stop_red = 0;
+    out.car_green = 0;
+    out.white = 0;
+    out.bytes_read = 0;
+    out.red_mask.clear();
+    out.white_mask.clear();
+    out.green_mask.clear();
+
+    for (int y = 0; y < height; y++) {
+        uint8_t* row = out.classes + y * width;
+        if (y < frame.y0) {
+            // Not captured; the zero row still goes through the packing so
+            // the masks and summed-area tables stay consistent
+            memset(row, 0, width);
+        } else if (lut) {
+            const uint8_t* px = frame.row(y);
+            for (int x = 0; x < width; x++, px += 2) {
+                row[x] = lut[RGB565::code(px)];
+            }
+        } else {
+            Swar::classify_row(frame.row(y), width, row);
+        }
+        if (y >= frame.y0) {
+            out.bytes_read += 2 * width;
+        }
+
+        // Pack the class row into the bit planes a word at a time
+        uint32_t* red = out.red_mask.row(y);
+        uint32_t* white = out.white_mask.row(y);
+        uint32_t* green = out.green_mask.row(y);
+        for (int w = 0; w < Mask::WORDS_PER_ROW; w++) {
+            uint32_t red_bits = 0;
+            uint32_t white_bits = 0;
+            uint32_t green_bits = 0;
+            for (int bit = 0, x = 32 * w; bit < 32 && x < width; bit++, x++) {
+                red_bits |= static_cast<uint32_t>(row[x] & CLASS_RED) << bit;
+                white_bits |= static_cast<uint32_t>((row[x] & CLASS_WHITE) >> 1) << bit;
+                green_bits |= static_cast<uint32_t>((row[x] & CLASS_GREEN) >> 2) << bit;
+            }
+            red[w] = red_bits;
+            white[w] = white_bits;
+            green[w] = green_bits;
+        }
+
+        if (integrals) {
+            integrals->red.add_row(y, red);
+            integrals->white.add_row(y, white);
+            integrals->green.add_row(y, green);
+        }
+
+        // The counts come from the class row, which is still in internal RAM
+        if (y >= STOPBOX.y0 && y < STOPBOX.y1) {
+            for (int x = STOPBOX.x0; x < STOPBOX.x1 && x < width; x++) {
+                out.stop_red += (row[x] & CLASS_RED) != 0;
+            }
+        }
+        if (y >= CARBOX.y0 && y < CARBOX.y1) {
+            for (int x = CARBOX.x0; x < CARBOX.x1 && x < width; x++) {
+                out.car_green += (row[x] & CLASS_GREEN) != 0;
+            }
+        }
+        if (y > WHITE_CROP_ROW) {
+            for (int x = 0; x < width; x++) {
+                out.white += (row[x] & CLASS_WHITE) != 0;
+            }
+        }
+    }
+}
+
+
+int Vision::RoiSet::add(const Rect& box, ClassBits cls, int threshold_percent)
+{
+    if (count_ >= MAX_ROIS) {
+        return -1;
+    }
+    rois_[count_] = {box, cls, threshold_percent};
+    return count_++;
+}
+
+
+void Vision::RoiSet::evaluate(const Integrals& integrals, BoxResult* out) const
+{
+    // The tables clip each box, so the percentage must be of the clipped area too
+    constexpr Rect bounds = {0, 0, MAX_WIDTH, MAX_HEIGHT};
+    for (int i = 0; i < count_; i++) {
+        const Roi& roi = rois_[i];
+        const Rect box = roi.box.clipped(bounds);
+        const int count = integrals.of(roi.cls).count(box.x0, box.y0, box.x1, box.y1);
+        out[i] = box_result(count, box.area(), roi.threshold_percent);
+    }
+}
+
+
+Vision::SteeringResult Vision::WhiteLineDetector::find_line(const Rect& window)
+{
+    SteeringResult result = {};
+    labeler_.label(mask_, window.y0, window.y1);
+
+    const int largest = labeler_.largest();
+    if (largest < 0) {
+        return result;
+    }
+
+    const Blob& blob = labeler_.blob(largest);
+    result.found = true;
+    result.area = blob.area;
+    result.centroid = blob.centroid;
+    result.top_left = blob.top_left;
+    result.bottom_left = blob.bottom_left;
+    result.steering = blob.top_left.x - WHITELINE_CENTER_POS;
+    result.line = fit_line(blob.moments);
+    result.bounds = blob.bounds;
+    return result;
+}
+
+
+void Vision::WhiteLineDetector::mask_window(const Frame& frame, const Rect& window)
+{
+    for (int y = window.y0; y < window.y1; y++) {
+        uint32_t* words = mask_.row(y);
+        for (int w = 0; w < Mask::WORDS_PER_ROW; w++) {
+            words[w] = 0;
+        }
+        for (int x = window.x0; x < window.x1; x++) {
+            if (is_white(frame.at(x, y))) {
+                words[x >> 5] |= 1u << (x & 31);
+            }
+        }
+    }
+}
+
+
+void Vision::WhiteLineDetector::mask_window(const Mask& mask, const Rect& window)
+{
+    // Bits of each word that fall in columns [x0, x1)
+    uint32_t columns[Mask::WORDS_PER_ROW];
+    for (int w = 0; w < Mask::WORDS_PER_ROW; w++) {
+        const int lo = window.x0 - 32 * w;
+        const int hi = window.x1 - 32 * w;
+        const uint32_t below_hi = hi >= 32 ? ~0u : (hi <= 0 ? 0u : (1u << hi) - 1);
+        const uint32_t below_lo = lo >= 32 ? ~0u : (lo <= 0 ? 0u : (1u << lo) - 1);
+        columns[w] = below_hi & ~below_lo;
+    }
+
+    for (int y = window.y0; y < window.y1; y++) {
+        const uint32_t* in = mask.row(y);
+        uint32_t* out = mask_.row(y);
+        for (int w = 0; w < Mask::WORDS_PER_ROW; w++) {
+            out[w] = in[w] & columns[w];
+        }
+    }
+}
+
+
+template <typename Source>
+Vision::SteeringResult Vision::WhiteLineDetector::search(const Source& source, int width, int first_row, int height)
+{
+    // Only the rows below the crop are ever labeled
+    const Rect full = {0, first_row > WHITE_CROP_ROW + 1 ? first_row : WHITE_CROP_ROW + 1, width, height};
+    const int search_area = full.y1 > full.y0 ? full.area() : 0;
+    int touched = 0;
+
+    SteeringResult result = {};
+    if (tracking_ && have_track_) {
+        const Rect window = track_.dilated(margin_).clipped(full);
+        mask_window(source, window);
+        result = find_line(window);
+        touched = window.area();
+
+        // Touching a window edge that is not a frame edge means the blob may continue outside
+        const Rect& b = result.bounds;
+        const bool clipped = (b.x0 == window.x0 && window.x0 > full.x0) || (b.y0 == window.y0 && window.y0 > full.y0) ||
+                             (b.x1 == window.x1 && window.x1 < full.x1) || (b.y1 == window.y1 && window.y1 < full.y1);
+        result.tracked = result.found && !clipped && 2 * result.area >= track_area_;
+    }
+
+    if (!result.tracked) {
+        mask_window(source, full);
+        result = find_line(full);
+        touched += search_area;
+    }
+
+    have_track_ = tracking_ && result.found && result.area >= TRACK_MIN_AREA;
+    track_ = result.bounds;
+    track_area_ = result.area;
+    result.pixels_touched = touched;
+    result.search_area = search_area;
+    return result;
+}
+
+
+void Vision::WhiteLineDetector::set_tracking(bool enabled, int margin)
+{
+    tracking_ = enabled;
+    margin_ = margin;
+    have_track_ = false;
+}
+
+
+Vision::SteeringResult Vision::WhiteLineDetector::detect(const Frame& frame)
+{
+    PROFILE_SCOPE(WhiteLine);
+    const int width = frame.width < MAX_WIDTH ? frame.width : MAX_WIDTH;
+    const int height = frame.height < MAX_HEIGHT ? frame.height : MAX_HEIGHT;
+    return search(frame, width, frame.y0, height);
+}
+
+
+Vision::SteeringResult Vision::WhiteLineDetector::detect(const Segmentation& segmentation)
+{
+    PROFILE_SCOPE(WhiteLine);
+    return search(segmentation.white_mask, segmentation.width, 0, segmentation.height);
+}
\ No newline at end of file
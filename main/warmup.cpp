@@ -0,0 +1,105 @@
+#include "warmup.hpp"
+
+#include <cstdlib>
+#include <esp_log.h>
+#include "camera.hpp"
+#include "profile.hpp"
+#include "rgb565.hpp"
+
+Warmup::FrameStats Warmup::compute_stats(const uint8_t* data, size_t len, int sample_step)
+{
+    const size_t step = (sample_step > 0 ? sample_step : 1) * 2;
+    uint32_t sum_r = 0;
+    uint32_t sum_g = 0;
+    uint32_t sum_b = 0;
+    uint32_t count = 0;
+
+    for (size_t i = 0; i + 1 < len; i += step) {
+        const uint16_t px = RGB565::code(data + i);
+        sum_r += RGB565::red8(px);
+        sum_g += RGB565::green8(px);
+        sum_b += RGB565::blue8(px);
+        count++;
+    }
+
+    FrameStats stats = {};
+    if (count == 0) {
+        return stats;
+    }
+
+    stats.mean_r = sum_r / count;
+    stats.mean_g = sum_g / count;
+    stats.mean_b = sum_b / count;
+    stats.luma = (77 * stats.mean_r + 150 * stats.mean_g + 29 * stats.mean_b) >> 8;
+
+    // Clamp so a near-black blue channel does not overflow the ratio
+    const uint32_t ratio = ((stats.mean_r + stats.mean_g) << 7) / (stats.mean_b + 1);
+    stats.chroma_ratio = ratio > UINT16_MAX ? UINT16_MAX : ratio;
+    return stats;
+}
+
+
+bool Warmup::Controller::is_close(const FrameStats& a, const FrameStats& b) const
+{
+    return std::abs(a.mean_r - b.mean_r) <= config_.tolerance
+        && std::abs(a.mean_g - b.mean_g) <= config_.tolerance
+        && std::abs(a.mean_b - b.mean_b) <= config_.tolerance
+        && std::abs(a.luma - b.luma) <= config_.tolerance
+        && std::abs(a.chroma_ratio - b.chroma_ratio) <= config_.ratio_tolerance;
+}
+
+
+bool Warmup::Controller::update(const uint8_t* data, size_t len)
+{
+    if (done_) {
+        return true;
+    }
+
+    PROFILE_SCOPE(Warmup);
+    const FrameStats stats = compute_stats(data, len, config_.sample_step);
+    if (frames_ > 0 && is_close(stats, last_)) {
+        stable_++;
+    } else {
+        stable_ = 0;
+    }
+    last_ = stats;
+    frames_++;
+
+    if (frames_ >= config_.min_frames && stable_ >= config_.stable_frames) {
+        converged_ = true;
+        done_ = true;
+    } else if (frames_ >= config_.max_frames) {
+        done_ = true;
+    }
+    return done_;
+}
+
+
+int Warmup::run(const Config& config, bool* converged)
+{
+    Controller controller(config);
+    int failures = 0;
+
+    while (!controller.done() && failures < config.max_frames) {
+        Camera::FrameHandle frame;
+        if (Camera::get_frame(frame) != ESP_OK) {
+            failures++;
+            continue;
+        }
+        controller.update(frame.data(), frame.size());
+    }
+
+    if (converged) {
+        *converged = controller.converged();
+    }
+
+    const FrameStats& stats = controller.last_stats();
+    if (controller.converged()) {
+        ESP_LOGI(TAG, "Sensor settled after %d frames (R %d G %d B %d, luma %d)",
+                 controller.frames(), stats.mean_r, stats.mean_g, stats.mean_b, stats.luma);
+    } else {
+        ESP_LOGW(TAG, "Sensor did not settle within %d frames (R %d G %d B %d, luma %d)",
+                 controller.frames(), stats.mean_r, stats.mean_g, stats.mean_b, stats.luma);
+    }
+    return controller.frames();
+}
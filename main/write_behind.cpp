@@ -0,0 +1,229 @@
+#include "write_behind.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+namespace {
+    struct Slot {
+        uint8_t* data;
+        size_t length;
+        uint16_t width;
+        uint16_t height;
+        uint16_t format;
+        uint64_t timestamp_us;
+        uint16_t first_row;
+    };
+
+    // Posted on the write queue to tell the writer task to exit
+    constexpr uint32_t STOP_SLOT = UINT32_MAX;
+
+    WriteBehind::Config config;
+    Container::Writer* sink = nullptr;
+    Slot* slots = nullptr;
+
+    // Indices of slots that are free to fill and slots waiting to be written
+    QueueHandle_t free_queue = nullptr;
+    QueueHandle_t write_queue = nullptr;
+    SemaphoreHandle_t task_done = nullptr;
+
+    std::atomic<uint32_t> submitted{0};
+    std::atomic<uint32_t> written{0};
+    std::atomic<uint32_t> dropped{0};
+    std::atomic<uint32_t> write_errors{0};
+    std::atomic<uint32_t> max_queue_depth{0};
+    std::atomic<uint64_t> bytes_written{0};
+    std::atomic<uint64_t> write_time_us{0};
+    std::atomic<uint64_t> stall_time_us{0};
+
+    void writer_loop(void*)
+    {
+        uint32_t index;
+        while (xQueueReceive(write_queue, &index, portMAX_DELAY) == pdTRUE && index != STOP_SLOT) {
+            Slot& slot = slots[index];
+
+            const int64_t start = esp_timer_get_time();
+            const esp_err_t err = sink->append(slot.data, slot.length, slot.width, slot.height,
+                                               slot.format, slot.timestamp_us, slot.first_row);
+            write_time_us.fetch_add(esp_timer_get_time() - start, std::memory_order_relaxed);
+
+            if (err == ESP_OK) {
+                written.fetch_add(1, std::memory_order_relaxed);
+                bytes_written.fetch_add(slot.length, std::memory_order_relaxed);
+            } else {
+                write_errors.fetch_add(1, std::memory_order_relaxed);
+            }
+            xQueueSend(free_queue, &index, portMAX_DELAY);
+        }
+
+        xSemaphoreGive(task_done);
+        vTaskDelete(nullptr);
+    }
+
+    void release_resources()
+    {
+        if (slots) {
+            for (size_t i = 0; i < config.slot_count; i++) {
+                heap_caps_free(slots[i].data);
+            }
+            delete[] slots;
+            slots = nullptr;
+        }
+        if (free_queue) {
+            vQueueDelete(free_queue);
+            free_queue = nullptr;
+        }
+        if (write_queue) {
+            vQueueDelete(write_queue);
+            write_queue = nullptr;
+        }
+        sink = nullptr;
+    }
+}
+
+
+esp_err_t WriteBehind::start(Container::Writer& writer, const Config& cfg)
+{
+    if (sink) {
+        ESP_LOGE(TAG, "Writer task already running");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (cfg.slot_count == 0 || cfg.slot_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    config = cfg;
+    sink = &writer;
+
+    // Stop markers share the write queue, so leave room for one
+    free_queue = xQueueCreate(config.slot_count, sizeof(uint32_t));
+    write_queue = xQueueCreate(config.slot_count + 1, sizeof(uint32_t));
+    if (!task_done) {
+        task_done = xSemaphoreCreateBinary();
+    }
+    slots = new Slot[config.slot_count]();
+    if (!free_queue || !write_queue || !task_done) {
+        ESP_LOGE(TAG, "Failed to create writer queues");
+        release_resources();
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (uint32_t i = 0; i < config.slot_count; i++) {
+        slots[i].data = static_cast<uint8_t*>(heap_caps_malloc(config.slot_size, MALLOC_CAP_SPIRAM));
+        if (!slots[i].data) {
+            ESP_LOGE(TAG, "Failed to allocate %u byte staging slot", (unsigned)config.slot_size);
+            release_resources();
+            return ESP_ERR_NO_MEM;
+        }
+        xQueueSend(free_queue, &i, 0);
+    }
+
+    submitted = 0;
+    written = 0;
+    dropped = 0;
+    write_errors = 0;
+    max_queue_depth = 0;
+    bytes_written = 0;
+    write_time_us = 0;
+    stall_time_us = 0;
+
+    if (xTaskCreatePinnedToCore(writer_loop, "write_behind", 4096, nullptr, config.priority,
+                                nullptr, config.core) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create writer task");
+        release_resources();
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Writer task started with %u staging slots", (unsigned)config.slot_count);
+    return ESP_OK;
+}
+
+
+void WriteBehind::stop()
+{
+    if (!sink) {
+        return;
+    }
+
+    // The marker queues up behind every frame still waiting to be written
+    const uint32_t stop_marker = STOP_SLOT;
+    xQueueSend(write_queue, &stop_marker, portMAX_DELAY);
+    xSemaphoreTake(task_done, portMAX_DELAY);
+
+    const Stats stats = get_stats();
+    ESP_LOGI(TAG, "Writer task stopped: %lu written, %lu dropped, %lu errors, %lu B/s, %llu us stalled",
+             (unsigned long)stats.written, (unsigned long)stats.dropped,
+             (unsigned long)stats.write_errors, (unsigned long)stats.bytes_per_second,
+             (unsigned long long)stats.stall_time_us);
+
+    release_resources();
+}
+
+
+esp_err_t WriteBehind::submit(const uint8_t* data, size_t length, uint16_t width, uint16_t height,
+                              uint16_t format, uint64_t timestamp_us, uint16_t first_row)
+{
+    if (!sink) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (length > config.slot_size) {
+        ESP_LOGE(TAG, "Frame of %u bytes does not fit a staging slot", (unsigned)length);
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint32_t index;
+    if (xQueueReceive(free_queue, &index, 0) != pdTRUE) {
+        if (config.policy == Policy::DropNewest) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return ESP_ERR_TIMEOUT;
+        }
+
+        // Every slot is queued: the card is behind, so hold up capture
+        const int64_t start = esp_timer_get_time();
+        xQueueReceive(free_queue, &index, portMAX_DELAY);
+        stall_time_us.fetch_add(esp_timer_get_time() - start, std::memory_order_relaxed);
+    }
+
+    Slot& slot = slots[index];
+    memcpy(slot.data, data, length);
+    slot.length = length;
+    slot.width = width;
+    slot.height = height;
+    slot.format = format;
+    slot.timestamp_us = timestamp_us;
+    slot.first_row = first_row;
+
+    xQueueSend(write_queue, &index, portMAX_DELAY);
+    submitted.fetch_add(1, std::memory_order_relaxed);
+
+    const uint32_t depth = uxQueueMessagesWaiting(write_queue);
+    uint32_t max_depth = max_queue_depth.load(std::memory_order_relaxed);
+    while (depth > max_depth && !max_queue_depth.compare_exchange_weak(max_depth, depth)) {
+    }
+    return ESP_OK;
+}
+
+
+WriteBehind::Stats WriteBehind::get_stats()
+{
+    Stats stats = {};
+    stats.submitted = submitted.load(std::memory_order_relaxed);
+    stats.written = written.load(std::memory_order_relaxed);
+    stats.dropped = dropped.load(std::memory_order_relaxed);
+    stats.write_errors = write_errors.load(std::memory_order_relaxed);
+    stats.queue_depth = write_queue ? uxQueueMessagesWaiting(write_queue) : 0;
+    stats.max_queue_depth = max_queue_depth.load(std::memory_order_relaxed);
+    stats.bytes_written = bytes_written.load(std::memory_order_relaxed);
+    stats.write_time_us = write_time_us.load(std::memory_order_relaxed);
+    stats.stall_time_us = stall_time_us.load(std::memory_order_relaxed);
+    if (stats.write_time_us > 0) {
+        stats.bytes_per_second = stats.bytes_written * 1000000 / stats.write_time_us;
+    }
+    return stats;
+}